@@ -52,6 +52,7 @@ gst_cheese_multiface_meta_init (GstMeta * meta, gpointer params,
   cheese_multiface_meta->faces = gst_cheese_multiface_info_new ();
   cheese_multiface_meta->removed_faces =
       g_array_new (FALSE, FALSE, sizeof (guint));
+  cheese_multiface_meta->pts = GST_CLOCK_TIME_NONE;
   return TRUE;
 }
 
@@ -77,6 +78,7 @@ gst_cheese_multiface_meta_transform (GstBuffer * dst_buf, GstMeta * meta,
   dst_meta->faces = gst_cheese_multiface_info_copy (src_meta->faces);
   g_array_append_vals (dst_meta->removed_faces, src_meta->removed_faces->data,
       sizeof (guint) * src_meta->removed_faces->len);
+  dst_meta->pts = src_meta->pts;
 
   return TRUE;
 }
@@ -58,6 +58,11 @@ typedef struct _GstCheeseMultifaceMeta GstCheeseMultifaceMeta;
  * GstCheeseMultifaceMeta:
  * @meta: The parent #GstMeta.
  * @faces: A dictionary of #CheeseFaceInfo where keys are the ids.
+ * @removed_faces: The ids of the faces that were removed since the last
+ * buffer.
+ * @pts: The presentation timestamp of the frame @faces was computed on. It
+ * only differs from the buffer timestamp when the faces were computed in the
+ * background on a previous frame.
  *
  * Metadata type that describes coordinates for each current detected face.
  *
@@ -67,6 +72,7 @@ struct _GstCheeseMultifaceMeta {
   GstMeta meta;
   GstCheeseMultifaceInfo *faces;
   GArray *removed_faces;
+  GstClockTime pts;
 };
 
 GType gst_cheese_multiface_meta_api_get_type (void);
@@ -0,0 +1,96 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "arena.h"
+
+CheeseArena::CheeseArena ()
+{
+  _size = CHEESE_ARENA_BLOCK_SIZE;
+  _block = (guint8 *) g_malloc (_size);
+  _offset = 0;
+  g_mutex_init (&_lock);
+}
+
+CheeseArena::~CheeseArena ()
+{
+  reset ();
+  g_free (_block);
+  g_mutex_clear (&_lock);
+}
+
+gpointer
+CheeseArena::allocate (gsize size)
+{
+  gsize offset;
+  gpointer mem;
+
+  size = (size + CHEESE_ARENA_ALIGN - 1) & ~((gsize) CHEESE_ARENA_ALIGN - 1);
+  offset = g_atomic_pointer_add (&_offset, size);
+  if (offset + size <= _size)
+    return _block + offset;
+
+  /* The offset keeps growing past the block, reset () learns from it how
+   * large the block should have been. */
+  mem = g_malloc (size);
+  g_mutex_lock (&_lock);
+  _overflow.push_back (mem);
+  g_mutex_unlock (&_lock);
+  return mem;
+}
+
+void
+CheeseArena::reset ()
+{
+  guint i;
+
+  if (!_overflow.empty ()) {
+    for (i = 0; i < _overflow.size (); i++)
+      g_free (_overflow[i]);
+    _overflow.clear ();
+    g_free (_block);
+    /* Some headroom, so the block is not grown on every new peak. */
+    _size = _offset + _offset / 2;
+    _block = (guint8 *) g_malloc (_size);
+  }
+  _offset = 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_ARENA_H__
+#define __GSTCHEESEFACE_ARENA_H__
+
+#include <glib.h>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+/* Every allocation is rounded up to, and aligned to, this many bytes. */
+#define CHEESE_ARENA_ALIGN              16
+/* Size of the block an arena starts with. */
+#define CHEESE_ARENA_BLOCK_SIZE         (64 * 1024)
+
+/**
+ * Bump allocator for the bookkeeping of a single frame. Allocating only
+ * moves an offset forward, freeing does nothing and reset () gives all the
+ * memory back at once when the frame is done. What does not fit in the
+ * block goes to the heap, and the next reset () grows the block so the
+ * following frames fit in it.
+ *
+ * Several threads may allocate at the same time, but nothing else may be
+ * running on the arena while it is reset.
+ **/
+struct CheeseArena {
+  private:
+    guint8 *_block;
+    gsize _size;
+    gsize _offset;
+    GMutex _lock;
+    std::vector<gpointer> _overflow;
+
+  public:
+    CheeseArena ();
+    ~CheeseArena ();
+
+    gpointer allocate (gsize size);
+    void reset ();
+};
+
+/* Lets the standard containers allocate from a CheeseArena. */
+template <typename T>
+struct CheeseArenaAllocator {
+  typedef T value_type;
+
+  CheeseArena *arena;
+
+  CheeseArenaAllocator (CheeseArena * arena) : arena (arena) {}
+
+  template <typename U>
+  CheeseArenaAllocator (const CheeseArenaAllocator<U> & other) :
+      arena (other.arena) {}
+
+  T * allocate (std::size_t n)
+  {
+    G_STATIC_ASSERT (alignof (T) <= CHEESE_ARENA_ALIGN);
+    return (T *) arena->allocate (n * sizeof (T));
+  }
+
+  void deallocate (T * ptr, std::size_t n)
+  {
+  }
+};
+
+template <typename T, typename U>
+bool
+operator== (const CheeseArenaAllocator<T> & a,
+    const CheeseArenaAllocator<U> & b)
+{
+  return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool
+operator!= (const CheeseArenaAllocator<T> & a,
+    const CheeseArenaAllocator<U> & b)
+{
+  return a.arena != b.arena;
+}
+
+template <typename T>
+using CheeseArenaVector = std::vector<T, CheeseArenaAllocator<T> >;
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_ARENA_H__ */
@@ -0,0 +1,370 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "assignment.h"
+
+CheeseAssignment::CheeseAssignment ()
+{
+  _rows = 0;
+  _cols = 0;
+}
+
+/* Makes room for a @rows x @cols matrix, the costs are left undefined. */
+void
+CheeseAssignment::resize (guint rows, guint cols)
+{
+  _rows = rows;
+  _cols = cols;
+  _costs.resize (rows * cols);
+}
+
+guint
+CheeseAssignment::rows ()
+{
+  return _rows;
+}
+
+guint
+CheeseAssignment::cols ()
+{
+  return _cols;
+}
+
+gfloat *
+CheeseAssignment::row (guint r)
+{
+  return &_costs[r * _cols];
+}
+
+gfloat &
+CheeseAssignment::at (guint r, guint c)
+{
+  return _costs[r * _cols + c];
+}
+
+/**
+ * The total cost can not be lower than the sum of the minimum of each row,
+ * or of each column if there are fewer of them. When those minimums are all
+ * in different columns, or rows, taking them is the solution. That is the
+ * common case when faces are tracked: each one is closest to its own
+ * detection.
+ **/
+gboolean
+CheeseAssignment::solve_separable (gint * assignment)
+{
+  guint r, c;
+
+  _matches.assign (MAX (_rows, _cols), -1);
+
+  if (_rows <= _cols) {
+    for (r = 0; r < _rows; r++) {
+      const gfloat *costs = row (r);
+      guint best = 0;
+
+      for (c = 1; c < _cols; c++) {
+        if (costs[c] < costs[best])
+          best = c;
+      }
+      if (_matches[best] != -1)
+        return FALSE;
+      _matches[best] = r;
+      assignment[r] = costs[best] < CHEESE_ASSIGNMENT_FORBIDDEN ? best : -1;
+    }
+    return TRUE;
+  }
+
+  for (r = 0; r < _rows; r++)
+    assignment[r] = -1;
+  for (c = 0; c < _cols; c++) {
+    guint best = 0;
+
+    for (r = 1; r < _rows; r++) {
+      if (at (r, c) < at (best, c))
+        best = r;
+    }
+    if (_matches[best] != -1)
+      return FALSE;
+    _matches[best] = c;
+    if (at (best, c) < CHEESE_ASSIGNMENT_FORBIDDEN)
+      assignment[best] = c;
+  }
+  return TRUE;
+}
+
+/**
+ * Jonker and Volgenant, "A shortest augmenting path algorithm for dense and
+ * sparse linear assignment problems", Computing 38 (1987). The matrix is
+ * padded to a square one with zero costs, which the rows and the columns
+ * left over end up assigned to.
+ **/
+void
+CheeseAssignment::solve_lapjv (gint * assignment)
+{
+  const gint n = MAX (_rows, _cols);
+  const gdouble big = G_MAXDOUBLE;
+  gdouble *cost, *v, *d;
+  gint *rowsol, *colsol, *matches, *free_rows, *collist, *pred;
+  gint i, j, k, i0, j1, j2 = 0, f, numfree = 0, prvnumfree, loopcnt;
+  gint freerow, low, up, last = 0, endofpath = 0;
+  gdouble min, h, umin, usubmin, v2;
+  gboolean unassignedfound;
+
+  _square.assign (n * n, 0.0);
+  for (i = 0; i < (gint) _rows; i++) {
+    for (j = 0; j < (gint) _cols; j++)
+      _square[i * n + j] = at (i, j);
+  }
+  _v.resize (n);
+  _d.resize (n);
+  _rowsol.assign (n, -1);
+  _colsol.assign (n, -1);
+  _matches.assign (n, 0);
+  _free.resize (n);
+  _collist.resize (n);
+  _pred.resize (n);
+  cost = _square.data ();
+  v = _v.data ();
+  d = _d.data ();
+  rowsol = _rowsol.data ();
+  colsol = _colsol.data ();
+  matches = _matches.data ();
+  free_rows = _free.data ();
+  collist = _collist.data ();
+  pred = _pred.data ();
+
+  /* Column reduction, in reverse order as it gives better results. */
+  for (j = n - 1; j >= 0; j--) {
+    gint imin = 0;
+
+    min = cost[j];
+    for (i = 1; i < n; i++) {
+      if (cost[i * n + j] < min) {
+        min = cost[i * n + j];
+        imin = i;
+      }
+    }
+    v[j] = min;
+    if (++matches[imin] == 1) {
+      rowsol[imin] = j;
+      colsol[j] = imin;
+    } else if (v[j] < v[rowsol[imin]]) {
+      j1 = rowsol[imin];
+      rowsol[imin] = j;
+      colsol[j] = imin;
+      colsol[j1] = -1;
+    } else {
+      colsol[j] = -1;
+    }
+  }
+
+  /* Reduction transfer */
+  for (i = 0; i < n; i++) {
+    if (matches[i] == 0) {
+      free_rows[numfree++] = i;
+    } else if (matches[i] == 1) {
+      j1 = rowsol[i];
+      min = big;
+      for (j = 0; j < n; j++) {
+        if (j != j1 && cost[i * n + j] - v[j] < min)
+          min = cost[i * n + j] - v[j];
+      }
+      /* A single column leaves nothing to transfer. */
+      if (min < big)
+        v[j1] -= min;
+    }
+  }
+
+  /* Augmenting row reduction, twice. */
+  for (loopcnt = 0; loopcnt < 2; loopcnt++) {
+    k = 0;
+    prvnumfree = numfree;
+    numfree = 0;
+    while (k < prvnumfree) {
+      i = free_rows[k++];
+
+      /* Lowest and second lowest reduced costs of the row. */
+      umin = cost[i * n] - v[0];
+      j1 = 0;
+      usubmin = big;
+      for (j = 1; j < n; j++) {
+        h = cost[i * n + j] - v[j];
+        if (h < usubmin) {
+          if (h >= umin) {
+            usubmin = h;
+            j2 = j;
+          } else {
+            usubmin = umin;
+            umin = h;
+            j2 = j1;
+            j1 = j;
+          }
+        }
+      }
+
+      i0 = colsol[j1];
+      if (umin < usubmin)
+        v[j1] -= usubmin - umin;
+      else if (i0 > -1) {
+        j1 = j2;
+        i0 = colsol[j2];
+      }
+
+      rowsol[i] = j1;
+      colsol[j1] = i;
+      if (i0 > -1) {
+        if (umin < usubmin)
+          free_rows[--k] = i0;
+        else
+          free_rows[numfree++] = i0;
+      }
+    }
+  }
+
+  /* Augment the solution for each free row. */
+  for (f = 0; f < numfree; f++) {
+    freerow = free_rows[f];
+
+    /* Dijkstra shortest path from the free row to an unassigned column. */
+    for (j = 0; j < n; j++) {
+      d[j] = cost[freerow * n + j] - v[j];
+      pred[j] = freerow;
+      collist[j] = j;
+    }
+    low = 0;
+    up = 0;
+    unassignedfound = FALSE;
+    min = 0.0;
+    do {
+      if (up == low) {
+        last = low - 1;
+        min = d[collist[up++]];
+        for (k = up; k < n; k++) {
+          j = collist[k];
+          h = d[j];
+          if (h <= min) {
+            if (h < min) {
+              up = low;
+              min = h;
+            }
+            collist[k] = collist[up];
+            collist[up++] = j;
+          }
+        }
+        for (k = low; k < up; k++) {
+          if (colsol[collist[k]] < 0) {
+            endofpath = collist[k];
+            unassignedfound = TRUE;
+            break;
+          }
+        }
+      }
+
+      if (!unassignedfound) {
+        j1 = collist[low++];
+        i = colsol[j1];
+        h = cost[i * n + j1] - v[j1] - min;
+        for (k = up; k < n; k++) {
+          j = collist[k];
+          v2 = cost[i * n + j] - v[j] - h;
+          if (v2 < d[j]) {
+            pred[j] = i;
+            if (v2 == min) {
+              if (colsol[j] < 0) {
+                endofpath = j;
+                unassignedfound = TRUE;
+                break;
+              }
+              collist[k] = collist[up];
+              collist[up++] = j;
+            }
+            d[j] = v2;
+          }
+        }
+      }
+    } while (!unassignedfound);
+
+    /* Update the prices of the columns that were scanned. */
+    for (k = 0; k <= last; k++) {
+      j1 = collist[k];
+      v[j1] += d[j1] - min;
+    }
+
+    /* Flip the assignments along the alternating path. */
+    do {
+      i = pred[endofpath];
+      colsol[endofpath] = i;
+      j1 = endofpath;
+      endofpath = rowsol[i];
+      rowsol[i] = j1;
+    } while (i != freerow);
+  }
+
+  for (i = 0; i < (gint) _rows; i++) {
+    j = rowsol[i];
+    if (j >= (gint) _cols || at (i, j) >= CHEESE_ASSIGNMENT_FORBIDDEN)
+      assignment[i] = -1;
+    else
+      assignment[i] = j;
+  }
+}
+
+/**
+ * Fills @assignment, of rows () elements, with the column assigned to each
+ * row or -1 if it has none.
+ **/
+void
+CheeseAssignment::solve (gint * assignment)
+{
+  guint r;
+
+  if (_cols == 0) {
+    for (r = 0; r < _rows; r++)
+      assignment[r] = -1;
+    return;
+  }
+  if (_rows == 0)
+    return;
+
+  if (!solve_separable (assignment))
+    solve_lapjv (assignment);
+}
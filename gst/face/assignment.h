@@ -0,0 +1,103 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_ASSIGNMENT_H__
+#define __GSTCHEESEFACE_ASSIGNMENT_H__
+
+#include <glib.h>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+/* Cost of the pairs that must never be assigned. Any other cost has to be
+ * lower than this. */
+#define CHEESE_ASSIGNMENT_FORBIDDEN     1e6f
+
+/**
+ * Solves the linear assignment problem of a cost matrix: pairs rows with
+ * columns so that the total cost is the lowest. The matrix does not need to
+ * be square, the rows that are left over are not assigned, and neither are
+ * those whose only choices are forbidden.
+ *
+ * The costs are stored row-major in a single array. If every row can take
+ * the cheapest column of its own, that is the solution and it is taken
+ * right away, otherwise the matrix is solved with the Jonker-Volgenant
+ * algorithm. The buffers are kept between calls, so solving matrices of
+ * similar sizes does not allocate.
+ **/
+struct CheeseAssignment {
+  private:
+    guint _rows;
+    guint _cols;
+    std::vector<gfloat> _costs;
+
+    /* Jonker-Volgenant state, on the square padded matrix. */
+    std::vector<gdouble> _square;
+    std::vector<gdouble> _v;
+    std::vector<gdouble> _d;
+    std::vector<gint> _rowsol;
+    std::vector<gint> _colsol;
+    std::vector<gint> _matches;
+    std::vector<gint> _free;
+    std::vector<gint> _collist;
+    std::vector<gint> _pred;
+
+    gboolean solve_separable (gint * assignment);
+    void solve_lapjv (gint * assignment);
+
+  public:
+    CheeseAssignment ();
+
+    void resize (guint rows, guint cols);
+    guint rows ();
+    guint cols ();
+    gfloat * row (guint r);
+    gfloat & at (guint r, guint c);
+
+    void solve (gint * assignment);
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_ASSIGNMENT_H__ */
@@ -0,0 +1,136 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "cameramotion.h"
+
+CheeseCameraMotion::CheeseCameraMotion ()
+{
+  n_inliers = 0;
+}
+
+/* Forgets the previous frame, the next one has no motion to estimate. */
+void
+CheeseCameraMotion::reset ()
+{
+  _previous.release ();
+  _corners.clear ();
+  n_inliers = 0;
+}
+
+/**
+ * Estimates the motion from the previous @luma to this one. On success,
+ * @motion maps the points of the previous frame to this one, in the
+ * coordinates of @luma.
+ **/
+gboolean
+CheeseCameraMotion::estimate (cv::Mat & luma, cv::Matx23d & motion)
+{
+  gdouble scale = MIN (1.0, (gdouble) CHEESE_CAMERA_MOTION_WIDTH / luma.cols);
+  cv::Mat estimate;
+  gboolean found = FALSE;
+  guint i;
+
+  n_inliers = 0;
+  if (scale < 1.0)
+    cv::resize (luma, _current, cv::Size (), scale, scale, cv::INTER_AREA);
+  else
+    luma.copyTo (_current);
+  if (_current.channels () != 1)
+    cv::cvtColor (_current, _current, cv::COLOR_RGB2GRAY);
+
+  if (_previous.size () != _current.size ()) {
+    _corners.clear ();
+    goto done;
+  }
+
+  if (_corners.size () < CHEESE_CAMERA_MOTION_MAX_CORNERS / 2) {
+    cv::goodFeaturesToTrack (_previous, _corners,
+        CHEESE_CAMERA_MOTION_MAX_CORNERS, 0.01,
+        CHEESE_CAMERA_MOTION_MIN_DISTANCE);
+  }
+  if (_corners.size () < CHEESE_CAMERA_MOTION_MIN_INLIERS)
+    goto done;
+
+  cv::calcOpticalFlowPyrLK (_previous, _current, _corners, _tracked, _status,
+      _errors, cv::Size (15, 15), 2);
+  _from.clear ();
+  _to.clear ();
+  for (i = 0; i < _corners.size (); i++) {
+    if (_status[i]) {
+      _from.push_back (_corners[i]);
+      _to.push_back (_tracked[i]);
+    }
+  }
+  _corners.clear ();
+  if (_from.size () < CHEESE_CAMERA_MOTION_MIN_INLIERS)
+    goto done;
+
+#if (CV_VERSION_MAJOR > 3 || (CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 2))
+  estimate = cv::estimateAffinePartial2D (_from, _to, _inliers, cv::RANSAC,
+      CHEESE_CAMERA_MOTION_THRESHOLD);
+  for (i = 0; i < _inliers.size (); i++) {
+    if (_inliers[i]) {
+      /* Followed again on the next frame. */
+      _corners.push_back (_to[i]);
+      n_inliers++;
+    }
+  }
+#else
+  estimate = cv::estimateRigidTransform (_from, _to, false);
+  _corners = _to;
+  n_inliers = _to.size ();
+#endif
+  if (estimate.empty () || n_inliers < CHEESE_CAMERA_MOTION_MIN_INLIERS)
+    goto done;
+
+  /* Back to the coordinates of @luma, only the translation changes. */
+  motion = cv::Matx23d ((const gdouble *) estimate.ptr<gdouble> ());
+  motion (0, 2) /= scale;
+  motion (1, 2) /= scale;
+  found = TRUE;
+
+done:
+  /* The buffers are swapped, so none is allocated while the size stays. */
+  cv::swap (_previous, _current);
+  return found;
+}
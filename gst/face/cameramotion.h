@@ -0,0 +1,95 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_CAMERA_MOTION_H__
+#define __GSTCHEESEFACE_CAMERA_MOTION_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+/* The luma plane is downscaled to at most this width. */
+#define CHEESE_CAMERA_MOTION_WIDTH          320
+/* Corners followed from frame to frame, they are searched again once fewer
+ * than half of them are left. */
+#define CHEESE_CAMERA_MOTION_MAX_CORNERS    200
+#define CHEESE_CAMERA_MOTION_MIN_DISTANCE   8
+/* Inliers needed to trust the estimate. */
+#define CHEESE_CAMERA_MOTION_MIN_INLIERS    16
+/* RANSAC reprojection threshold, in downscaled pixels. */
+#define CHEESE_CAMERA_MOTION_THRESHOLD      1.0
+
+/**
+ * Estimates the global motion of the camera between two frames. Corners of
+ * the downscaled luma plane are followed with sparse Lucas-Kanade optical
+ * flow and a similarity, rotation, uniform scale and translation, is fitted
+ * to them with RANSAC, so the faces moving on their own are left out as
+ * outliers.
+ **/
+struct CheeseCameraMotion {
+  private:
+    cv::Mat _previous;
+    cv::Mat _current;
+    std::vector<cv::Point2f> _corners;
+    std::vector<cv::Point2f> _tracked;
+    std::vector<guint8> _status;
+    std::vector<gfloat> _errors;
+    std::vector<cv::Point2f> _from;
+    std::vector<cv::Point2f> _to;
+    std::vector<guint8> _inliers;
+
+  public:
+    /* Inliers of the last estimate. */
+    guint n_inliers;
+
+    CheeseCameraMotion ();
+    void reset ();
+    gboolean estimate (cv::Mat & luma, cv::Matx23d & motion);
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_CAMERA_MOTION_H__ */
@@ -0,0 +1,423 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "facedetector.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <math.h>
+
+/**
+ * The pyramid levels are all loaded first, one task per level, since the HOG
+ * features of a level are shared by all the filters. Then every filter is
+ * run over every level, one task per (level, filter) pair. Only the levels
+ * from @first_level on are scanned.
+ **/
+template <typename pixel_type>
+struct CheeseFaceDetectorBatch {
+  guint first_level;
+  std::vector<CheeseFaceScanner> *scanners;
+  const std::vector<CheeseFaceScanner::fhog_filterbank> *filterbanks;
+  const std::vector<double> *thresholds;
+  const dlib::cv_image<pixel_type> *base_level;
+  std::vector<dlib::array2d<pixel_type> > levels;
+  std::vector<std::vector<std::pair<double, dlib::rectangle> > > hits;
+};
+
+template <typename pixel_type>
+static void
+cheese_face_detector_load_level_task (guint index, gpointer user_data)
+{
+  CheeseFaceDetectorBatch<pixel_type> *batch =
+      (CheeseFaceDetectorBatch<pixel_type> *) user_data;
+  guint level = batch->first_level + index;
+
+  if (level == 0)
+    (*batch->scanners)[0].load (*batch->base_level);
+  else
+    (*batch->scanners)[level].load (batch->levels[level - 1]);
+}
+
+template <typename pixel_type>
+static void
+cheese_face_detector_scan_level_task (guint index, gpointer user_data)
+{
+  CheeseFaceDetectorBatch<pixel_type> *batch =
+      (CheeseFaceDetectorBatch<pixel_type> *) user_data;
+  guint n_filters = batch->filterbanks->size ();
+  guint level = batch->first_level + index / n_filters;
+  guint filter = index % n_filters;
+
+  (*batch->scanners)[level].detect ((*batch->filterbanks)[filter],
+      batch->hits[index], (*batch->thresholds)[filter]);
+}
+
+/* Every region is scanned by its own detector, sequentially. */
+struct CheeseFaceDetectorRegionBatch {
+  std::vector<dlib::frontal_face_detector> *detectors;
+  cv::Mat *img;
+  const std::vector<cv::Rect> *regions;
+  std::vector<std::vector<dlib::rect_detection> > hits;
+};
+
+static void
+cheese_face_detector_region_task (guint index, gpointer user_data)
+{
+  CheeseFaceDetectorRegionBatch *batch =
+      (CheeseFaceDetectorRegionBatch *) user_data;
+  const cv::Rect & region = (*batch->regions)[index];
+  cv::Mat crop = (*batch->img) (region);
+  std::vector<dlib::rect_detection> & hits = batch->hits[index];
+  guint i;
+
+  if (crop.channels () == 1)
+    (*batch->detectors)[index] (dlib::cv_image<unsigned char> (crop), hits);
+  else
+    (*batch->detectors)[index] (dlib::cv_image<dlib::bgr_pixel> (crop), hits);
+
+  for (i = 0; i < hits.size (); i++)
+    hits[i].rect = dlib::translate_rect (hits[i].rect, region.x, region.y);
+}
+
+/* Positions of the tiles along one axis, the last one is flush with the end. */
+static void
+cheese_face_detector_split_axis (gint length, gint tile, gint step,
+    std::vector<gint> & starts)
+{
+  gint start = 0;
+
+  while (start + tile < length) {
+    starts.push_back (start);
+    start += step;
+  }
+  starts.push_back (MAX (length - tile, 0));
+}
+
+void
+cheese_face_detector_split_tiles (const cv::Size & size, guint tile_size,
+    guint tile_overlap, std::vector<cv::Rect> & tiles)
+{
+  std::vector<gint> xs, ys;
+  gint tile = tile_size;
+  gint step;
+  guint i, j;
+
+  step = tile_overlap < tile_size ? tile_size - tile_overlap : tile_size / 2;
+  step = MAX (step, 1);
+  cheese_face_detector_split_axis (size.width, tile, step, xs);
+  cheese_face_detector_split_axis (size.height, tile, step, ys);
+
+  for (j = 0; j < ys.size (); j++) {
+    for (i = 0; i < xs.size (); i++) {
+      tiles.push_back (cv::Rect (xs[i], ys[j], MIN (tile, size.width - xs[i]),
+          MIN (tile, size.height - ys[j])));
+    }
+  }
+}
+
+/**
+ * Gives the slice of @n_slices scanning @level of an image pyramid of
+ * @n_levels levels. The slices are groups of consecutive levels, from the
+ * base one, each about its share of the area of the pyramid, so they cost
+ * about the same. The base level alone takes almost a
+ * third of it though. While there are enough levels every slice gets one.
+ **/
+guint
+cheese_face_detector_level_slice (guint level, guint n_levels,
+    guint n_slices)
+{
+  const gdouble ratio = CHEESE_FACE_DETECTOR_LEVEL_AREA;
+  const gdouble total = (1.0 - pow (ratio, n_levels)) / (1.0 - ratio);
+  gdouble below = 0.0;
+  guint slice = 0;
+  guint i;
+
+  g_return_val_if_fail (level < n_levels && n_slices > 0, 0);
+
+  /* A level starts the next slice when most of it is past the share of
+   * the current one. */
+  for (i = 1; i <= level; i++) {
+    below += pow (ratio, i - 1);
+    if (slice + 1 < n_slices &&
+        (below + pow (ratio, i) / 2.0 > total * (slice + 1) / n_slices ||
+            n_levels - i <= n_slices - 1 - slice))
+      slice++;
+  }
+  return slice;
+}
+
+CheeseFaceDetector::CheeseFaceDetector ()
+{
+  guint i;
+
+  _detector = dlib::get_frontal_face_detector ();
+  const CheeseFaceScanner & scanner = _detector.get_scanner ();
+  for (i = 0; i < _detector.num_detectors (); i++) {
+    const CheeseFaceScanner::feature_vector_type & w = _detector.get_w (i);
+    _filterbanks.push_back (scanner.build_fhog_filterbank (w));
+    _thresholds.push_back (w (scanner.get_num_dimensions ()));
+  }
+  max_threads = 0;
+}
+
+/* Same number of levels dlib::scan_fhog_pyramid would build. */
+guint
+CheeseFaceDetector::n_levels (long width, long height)
+{
+  const CheeseFaceScanner & scanner = _detector.get_scanner ();
+  dlib::pyramid_down<6> pyr;
+  dlib::rectangle rect (width, height);
+  guint levels = 0;
+
+  do {
+    rect = pyr.rect_down (rect);
+    levels++;
+  } while (rect.width () >= scanner.get_min_pyramid_layer_width () &&
+      rect.height () >= scanner.get_min_pyramid_layer_height () &&
+      levels < scanner.get_max_pyramid_levels ());
+
+  return levels;
+}
+
+/* Scans the levels from @first_level to @last_level, excluded, appending
+ * the hits to @dets. */
+template <typename pixel_type>
+void
+CheeseFaceDetector::scan (const dlib::cv_image<pixel_type> & img,
+    guint first_level, guint last_level,
+    std::vector<dlib::rect_detection> & dets)
+{
+  CheeseFaceDetectorBatch<pixel_type> batch;
+  dlib::pyramid_down<6> pyr;
+  guint levels = MIN (n_levels (img.nc (), img.nr ()), last_level);
+  guint n_filters = _filterbanks.size ();
+  guint n_scanned;
+  guint i, j;
+
+  if (first_level >= levels)
+    return;
+  n_scanned = levels - first_level;
+
+  while (_scanners.size () < levels) {
+    _scanners.push_back (_detector.get_scanner ());
+    _scanners.back ().set_max_pyramid_levels (1);
+  }
+
+  /* Each level is downsampled from the previous one, as dlib does. */
+  batch.levels.resize (levels - 1);
+  for (i = 1; i < levels; i++) {
+    if (i == 1)
+      pyr (img, batch.levels[0]);
+    else
+      pyr (batch.levels[i - 2], batch.levels[i - 1]);
+  }
+
+  batch.first_level = first_level;
+  batch.scanners = &_scanners;
+  batch.filterbanks = &_filterbanks;
+  batch.thresholds = &_thresholds;
+  batch.base_level = &img;
+  batch.hits.resize (n_scanned * n_filters);
+
+  cheese_worker_pool_run (n_scanned, max_threads,
+      cheese_face_detector_load_level_task<pixel_type>, &batch);
+  cheese_worker_pool_run (n_scanned * n_filters, max_threads,
+      cheese_face_detector_scan_level_task<pixel_type>, &batch);
+
+  for (i = 0; i < batch.hits.size (); i++) {
+    guint level = first_level + i / n_filters;
+    guint filter = i % n_filters;
+    for (j = 0; j < batch.hits[i].size (); j++) {
+      dlib::rect_detection det;
+      det.detection_confidence = batch.hits[i][j].first - _thresholds[filter];
+      det.weight_index = filter;
+      det.rect = pyr.rect_up (batch.hits[i][j].second, level);
+      dets.push_back (det);
+    }
+  }
+}
+
+/* Non-maximum suppression, like dlib::object_detector does it. */
+std::vector<dlib::rectangle>
+CheeseFaceDetector::suppress (std::vector<dlib::rect_detection> & hits)
+{
+  std::vector<dlib::rectangle> dets;
+  dlib::test_box_overlap overlaps = _detector.get_overlap_tester ();
+  guint i, j;
+
+  std::sort (hits.rbegin (), hits.rend ());
+  for (i = 0; i < hits.size (); i++) {
+    gboolean overlapped = FALSE;
+    for (j = 0; j < dets.size () && !overlapped; j++)
+      overlapped = overlaps (hits[i].rect, dets[j]);
+    if (!overlapped)
+      dets.push_back (hits[i].rect);
+  }
+
+  return dets;
+}
+
+std::vector<dlib::rectangle>
+CheeseFaceDetector::detect (cv::Mat & img)
+{
+  std::vector<dlib::rect_detection> hits;
+
+  if (img.channels () == 1)
+    scan (dlib::cv_image<unsigned char> (img), 0, G_MAXUINT, hits);
+  else
+    scan (dlib::cv_image<dlib::bgr_pixel> (img), 0, G_MAXUINT, hits);
+
+  return suppress (hits);
+}
+
+/**
+ * Scans each region of the image on its own core and maps the hits back to
+ * image coordinates. Faces found twice where regions overlap are merged by
+ * the non-maximum suppression.
+ **/
+std::vector<dlib::rectangle>
+CheeseFaceDetector::detect_regions (cv::Mat & img,
+    const std::vector<cv::Rect> & regions)
+{
+  CheeseFaceDetectorRegionBatch batch;
+  std::vector<dlib::rect_detection> hits;
+  guint i;
+
+  while (_region_detectors.size () < regions.size ())
+    _region_detectors.push_back (_detector);
+
+  batch.detectors = &_region_detectors;
+  batch.img = &img;
+  batch.regions = &regions;
+  batch.hits.resize (regions.size ());
+  cheese_worker_pool_run (regions.size (), max_threads,
+      cheese_face_detector_region_task, &batch);
+
+  for (i = 0; i < batch.hits.size (); i++)
+    hits.insert (hits.end (), batch.hits[i].begin (), batch.hits[i].end ());
+
+  return suppress (hits);
+}
+
+/**
+ * Splits the image in overlapping tiles and scans them in parallel. A face is
+ * entirely inside some tile as long as it is not bigger than the overlap.
+ **/
+std::vector<dlib::rectangle>
+CheeseFaceDetector::detect_tiles (cv::Mat & img, guint tile_size,
+    guint tile_overlap)
+{
+  std::vector<cv::Rect> tiles;
+
+  cheese_face_detector_split_tiles (img.size (), tile_size, tile_overlap,
+      tiles);
+
+  return detect_regions (img, tiles);
+}
+
+/**
+ * Scans the levels of the image pyramid of @img that belong to @slice of
+ * @n_slices, see cheese_face_detector_level_slice (), and appends their hits
+ * to @hits. The hits of all the slices, merged by suppress (), are the
+ * detections of detect ().
+ **/
+void
+CheeseFaceDetector::detect_slice (cv::Mat & img, guint slice, guint n_slices,
+    std::vector<dlib::rect_detection> & hits)
+{
+  const guint levels = n_levels (img.cols, img.rows);
+  guint first = levels, last = 0;
+  guint i;
+
+  for (i = 0; i < levels; i++) {
+    if (cheese_face_detector_level_slice (i, levels, n_slices) == slice) {
+      first = MIN (first, i);
+      last = i + 1;
+    }
+  }
+
+  if (img.channels () == 1)
+    scan (dlib::cv_image<unsigned char> (img), first, last, hits);
+  else
+    scan (dlib::cv_image<dlib::bgr_pixel> (img), first, last, hits);
+}
+  return kept;
+}
+
+/**
+ * Searches candidates in a heavily downscaled copy of the image and detects
+ * them again in full resolution crops around them. Candidates not confirmed
+ * at full resolution are dropped.
+ **/
+std::vector<dlib::rectangle>
+CheeseFaceDetector::detect_coarse_to_fine (cv::Mat & img,
+    gdouble coarse_scale_factor)
+{
+  std::vector<dlib::rectangle> candidates;
+  std::vector<cv::Rect> crops;
+  cv::Rect bounds (0, 0, img.cols, img.rows);
+  guint i;
+
+  cv::resize (img, _coarse_img, cv::Size (img.cols * coarse_scale_factor,
+      img.rows * coarse_scale_factor), 0, 0, cv::INTER_AREA);
+  candidates = detect (_coarse_img);
+  if (candidates.empty ())
+    return candidates;
+
+  for (i = 0; i < candidates.size (); i++) {
+    gdouble margin_x = candidates[i].width () *
+        CHEESE_FACE_DETECTOR_REFINE_MARGIN;
+    gdouble margin_y = candidates[i].height () *
+        CHEESE_FACE_DETECTOR_REFINE_MARGIN;
+    cv::Rect crop (
+        cv::Point ((candidates[i].left () - margin_x) / coarse_scale_factor,
+            (candidates[i].top () - margin_y) / coarse_scale_factor),
+        cv::Point ((candidates[i].right () + margin_x) / coarse_scale_factor,
+            (candidates[i].bottom () + margin_y) / coarse_scale_factor));
+    crop &= bounds;
+    if (crop.area () > 0)
+      crops.push_back (crop);
+  }
+
+  return detect_regions (img, crops);
+}
@@ -0,0 +1,111 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_FACE_DETECTOR_H__
+#define __GSTCHEESEFACE_FACE_DETECTOR_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+#include <dlib/opencv.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+G_BEGIN_DECLS
+
+/* Margin added on each side of a candidate, relative to its size, to get the
+ * crop it is detected again in. */
+#define CHEESE_FACE_DETECTOR_REFINE_MARGIN    0.5
+/* Side in pixels of the detection window, no smaller face is found. */
+#define CHEESE_FACE_DETECTOR_WINDOW_SIZE      80
+/* Area of a level of the image pyramid relative to the one below it,
+ * dlib::pyramid_down<6> keeps 5 pixels out of 6 along each axis. */
+#define CHEESE_FACE_DETECTOR_LEVEL_AREA       ((5.0 / 6.0) * (5.0 / 6.0))
+
+typedef dlib::scan_fhog_pyramid<dlib::pyramid_down<6> > CheeseFaceScanner;
+
+/**
+ * Wraps dlib's frontal face detector to scan the levels of the image pyramid
+ * with each of its HOG filters in parallel. The hits are merged with the same
+ * non-maximum suppression as dlib::object_detector, so the detections are
+ * the ones of get_frontal_face_detector ().
+ **/
+struct CheeseFaceDetector {
+  private:
+    dlib::frontal_face_detector _detector;
+    std::vector<CheeseFaceScanner::fhog_filterbank> _filterbanks;
+    std::vector<double> _thresholds;
+    /* One single level scanner per pyramid level, they hold the features. */
+    std::vector<CheeseFaceScanner> _scanners;
+    /* One whole detector per region scanned in parallel. */
+    std::vector<dlib::frontal_face_detector> _region_detectors;
+    cv::Mat _coarse_img;
+
+    guint n_levels (long width, long height);
+    template <typename pixel_type>
+    void scan (const dlib::cv_image<pixel_type> & img, guint first_level,
+        guint last_level, std::vector<dlib::rect_detection> & dets);
+
+  public:
+    guint max_threads;
+
+    CheeseFaceDetector ();
+    std::vector<dlib::rectangle> detect (cv::Mat & img);
+    std::vector<dlib::rectangle> detect_regions (cv::Mat & img,
+        const std::vector<cv::Rect> & regions);
+    std::vector<dlib::rectangle> detect_tiles (cv::Mat & img, guint tile_size,
+        guint tile_overlap);
+    void detect_slice (cv::Mat & img, guint slice, guint n_slices,
+        std::vector<dlib::rect_detection> & hits);
+    std::vector<dlib::rectangle> suppress (
+        std::vector<dlib::rect_detection> & hits);
+    std::vector<dlib::rectangle> detect_coarse_to_fine (cv::Mat & img,
+        gdouble coarse_scale_factor);
+};
+
+void cheese_face_detector_split_tiles (const cv::Size & size, guint tile_size,
+    guint tile_overlap, std::vector<cv::Rect> & tiles);
+guint cheese_face_detector_level_slice (guint level, guint n_levels,
+    guint n_slices);
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_FACE_DETECTOR_H__ */
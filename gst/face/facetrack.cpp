@@ -44,6 +44,14 @@
 #include <gst/cheese/face/cheesemultifacemeta.h>
 #include "utils.h"
 #include "facetrack.h"
+#include "workerpool.h"
+
+struct CheeseFaceTrackerBatch {
+  CheeseFace **faces;
+  cv::Mat *frame;
+  CheeseFlowPyramid *pyramid;
+  gboolean *found;
+};
 
 CheeseFace::CheeseFace ()
 {
@@ -51,12 +59,21 @@ CheeseFace::CheeseFace ()
   free_user_data_func = NULL;
   _previous_bounding_box_exists = FALSE;
   _state = CHEESE_FACE_INFO_STATE_TRACKER_UNSET;
+  _restart_tracker = FALSE;
+  _restarted = FALSE;
+  _pool = NULL;
+  _mosse_slot = -1;
+  _confidence = 0.0;
+  landmark_predicted_frame = 0;
+  landmark_frame = 0;
 }
 
 CheeseFace::~CheeseFace ()
 {
   if (user_data && free_user_data_func)
     free_user_data_func (user_data);
+  if (_mosse_slot >= 0)
+    _pool->mosse ()->remove (_mosse_slot);
 }
 
 GstCheeseFaceInfo *
@@ -93,21 +110,71 @@ CheeseFace::to_face_info_at_scale (gdouble scale_factor)
   return info;
 }
 
+/* Moves the box to where the motion of the face predicts it. */
+void
+CheeseFace::coast ()
+{
+  if (!_motion.initialized ())
+    return;
+  _previous_bounding_box = _bounding_box;
+  _bounding_box = _motion.box ();
+}
+
+/**
+ * Steps the motion of the face one frame and updates the tracker. When there
+ * is no tracker or it loses its target, the box is the predicted one. A
+ * tracker left behind by the camera starts again there instead, which is
+ * told by restarted (). @pyramid must hold @frame for the shared median flow
+ * tracker.
+ **/
 gboolean
-CheeseFace::update_tracker (cv::Mat & frame)
+CheeseFace::update_tracker (cv::Mat & frame, CheeseFlowPyramid * pyramid)
 {
   gboolean target_found;
   cv::Rect2d tmp;
 
-  if (_state == CHEESE_FACE_INFO_STATE_TRACKER_UNSET)
+  _motion.predict ();
+  _confidence = 0.0;
+  _restarted = FALSE;
+  if (_state == CHEESE_FACE_INFO_STATE_TRACKER_UNSET) {
+    coast ();
     return FALSE;
+  }
+  /* Nothing is measured on a restart, the box is where the camera moved
+   * it. The fresh tracker is fully confident all the same, a camera
+   * motion alone is no reason to search the face again. */
+  if (_restart_tracker) {
+    _restart_tracker = FALSE;
+    _restarted = TRUE;
+    coast ();
+    create_tracker (_tracker_type, _pool);
+    init_tracker (frame);
+    return _state == CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED;
+  }
   /* Update tracker and swap previous and current bounding box if found. */
   tmp = _bounding_box;
-  target_found = _tracker->update(frame, _bounding_box);
-  if (target_found)
-    _previous_bounding_box = tmp;
+  if (_tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW)
+    target_found = pyramid && _median_flow.update (*pyramid, _bounding_box);
+  else if (_tracker_type == GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE)
+    target_found = _pool->mosse ()->track (_mosse_slot, frame,
+        _bounding_box);
   else
+    target_found = _tracker->update(frame, _bounding_box);
+  if (target_found) {
+    /* The OpenCV trackers tell nothing but whether they found it. */
+    if (_tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW)
+      _confidence = _median_flow.confidence ();
+    else if (_tracker_type == GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE)
+      _confidence = _pool->mosse ()->confidence (_mosse_slot);
+    else
+      _confidence = 1.0;
+    _previous_bounding_box = tmp;
+    _motion.correct (_bounding_box);
+  } else {
     release_tracker ();
+    _bounding_box = tmp;
+    coast ();
+  }
   return target_found;
 }
 
@@ -151,6 +218,77 @@ CheeseFace::get_previous_bounding_box (cv::Rect2d & ret)
   return TRUE;
 }
 
+/**
+ * How sure the tracker is of the last update, from 0 to 1: the peak to
+ * sidelobe ratio of the MOSSE filter, the forward-backward error of the
+ * median flow or, for the OpenCV trackers, whether the target was found.
+ * A freshly initialised tracker is fully confident.
+ **/
+gdouble
+CheeseFace::confidence ()
+{
+  return _confidence;
+}
+
+/**
+ * Whether the last update started the tracker again after the camera moved,
+ * instead of tracking. The box was then estimated, not measured.
+ **/
+gboolean
+CheeseFace::restarted ()
+{
+  return _restarted;
+}
+
+/* Distance from the centroid where a detection may still be this face. */
+gdouble
+CheeseFace::motion_gate_radius ()
+{
+  if (!_motion.initialized ())
+    return G_MAXDOUBLE;
+  return _motion.gate_radius ();
+}
+
+/**
+ * Moves the face along with the camera, @motion maps the previous frame to
+ * the current one. If the face moved more than @restart_factor times its
+ * width, the tracker is started again at the new box on its next update, as
+ * it would not search that far. Closer, only the MOSSE filter, which
+ * searches around the box it is given in the new frame, takes the moved box.
+ * The OpenCV trackers keep their own box and the median flow follows the
+ * box of the previous frame, so both measure the motion of the camera
+ * themselves. Returns how far the centroid was moved.
+ **/
+gdouble
+CheeseFace::follow_camera (const cv::Matx23d & motion,
+    gdouble restart_factor)
+{
+  const gdouble scale = sqrt (fabs (motion (0, 0) * motion (1, 1) -
+      motion (0, 1) * motion (1, 0)));
+  cv::Point2d centroid, moved;
+  cv::Size2d size;
+
+  centroid = (_bounding_box.tl () + _bounding_box.br ()) * 0.5;
+  moved = cv::Point2d (
+      motion (0, 0) * centroid.x + motion (0, 1) * centroid.y + motion (0, 2),
+      motion (1, 0) * centroid.x + motion (1, 1) * centroid.y + motion (1, 2));
+  size = _bounding_box.size () * scale;
+  if (_state != CHEESE_FACE_INFO_STATE_TRACKER_UNSET &&
+      cv::norm (moved - centroid) > restart_factor * _bounding_box.width)
+    _restart_tracker = TRUE;
+  if (_state == CHEESE_FACE_INFO_STATE_TRACKER_UNSET || _restart_tracker ||
+      _tracker_type == GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE)
+    _bounding_box = cv::Rect2d (moved - cv::Point2d (size) * 0.5, size);
+  _motion.transform (motion);
+  return cv::norm (moved - centroid);
+}
+
+std::vector<cv::Point> &
+CheeseFace::landmark ()
+{
+  return _landmark;
+}
+
 void
 CheeseFace::set_last_detected_frame (guint frame_number)
 {
@@ -163,6 +301,7 @@ CheeseFace::set_bounding_box (dlib::rectangle & rect)
   _previous_bounding_box = _bounding_box;
   dlib_rectangle_to_cv_rect (rect, _bounding_box);
   _previous_bounding_box_exists = TRUE;
+  _motion.correct (_bounding_box);
 }
 
 void
@@ -171,38 +310,48 @@ CheeseFace::set_landmark (std::vector<cv::Point> & landmark)
   _landmark = landmark;
 }
 
+/**
+ * Takes a tracker of @tracker_type from @pool. The face takes a slot of the
+ * MOSSE filters of @pool the first time and keeps it, so they are only ever
+ * added to from the thread creating the faces.
+ **/
 void
-CheeseFace::create_tracker (GstCheeseFaceTrackTrackerType tracker_type)
+CheeseFace::create_tracker (GstCheeseFaceTrackTrackerType tracker_type,
+    CheeseTrackerPool * pool)
 {
   _state = CHEESE_FACE_INFO_STATE_TRACKER_UNINITIALIZED;
+  _tracker_type = tracker_type;
+  _pool = pool;
   switch (tracker_type) {
-    case GST_CHEESEFACETRACK_TRACKER_BOOSTING:
-      _tracker = cv::TrackerBoosting::create ();
-      break;
-    case GST_CHEESEFACETRACK_TRACKER_GOTURN:
-      _tracker = cv::TrackerGOTURN::create ();
-      break;
-    case GST_CHEESEFACETRACK_TRACKER_KCF:
-      _tracker = cv::TrackerKCF::create ();
-      break;
-    case GST_CHEESEFACETRACK_TRACKER_MEDIANFLOW:
-      _tracker = cv::TrackerMedianFlow::create ();
-      break;
-    case GST_CHEESEFACETRACK_TRACKER_MIL:
-      _tracker = cv::TrackerMIL::create ();
+    case GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW:
+      /* Needs nothing but the pyramids of the frame. */
+      _tracker.release ();
       break;
-    case GST_CHEESEFACETRACK_TRACKER_TLD:
-      _tracker = cv::TrackerTLD::create ();
+    case GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE:
+      _tracker.release ();
+      if (_mosse_slot < 0)
+        _mosse_slot = _pool->mosse ()->add ();
       break;
     default:
-      _state = CHEESE_FACE_INFO_STATE_TRACKER_UNSET;
-      g_assert_not_reached ();
+      _tracker = _pool->acquire (tracker_type);
+      if (!_tracker)
+        _state = CHEESE_FACE_INFO_STATE_TRACKER_UNSET;
   }
 }
 
 void
 CheeseFace::init_tracker (cv::Mat & img)
 {
+  _confidence = 1.0;
+  if (_tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW) {
+    _state = CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED;
+    return;
+  }
+  if (_tracker_type == GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE) {
+    _pool->mosse ()->init (_mosse_slot, img, _bounding_box);
+    _state = CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED;
+    return;
+  }
   /* FIXME: Check if the tracker is set and init before doing this */
   if (_tracker->init (img, _bounding_box))
     _state = CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED;
@@ -211,6 +360,139 @@ CheeseFace::init_tracker (cv::Mat & img)
 void
 CheeseFace::release_tracker ()
 {
+  /* An OpenCV tracker cannot be initialised again, it goes. The MOSSE slot
+   * stays, it is trained again in place. */
   _tracker.release ();
   _state = CHEESE_FACE_INFO_STATE_TRACKER_UNSET;
+  _restart_tracker = FALSE;
+}
+
+static cv::Ptr<cv::Tracker>
+cheese_tracker_create (GstCheeseFaceTrackTrackerType tracker_type)
+{
+  switch (tracker_type) {
+    case GST_CHEESEFACETRACK_TRACKER_BOOSTING:
+      return cv::TrackerBoosting::create ();
+    case GST_CHEESEFACETRACK_TRACKER_GOTURN:
+      return cv::TrackerGOTURN::create ();
+    case GST_CHEESEFACETRACK_TRACKER_KCF:
+      return cv::TrackerKCF::create ();
+    case GST_CHEESEFACETRACK_TRACKER_MEDIANFLOW:
+      return cv::TrackerMedianFlow::create ();
+    case GST_CHEESEFACETRACK_TRACKER_MIL:
+      return cv::TrackerMIL::create ();
+    case GST_CHEESEFACETRACK_TRACKER_TLD:
+      return cv::TrackerTLD::create ();
+    default:
+      g_assert_not_reached ();
+  }
+  return cv::Ptr<cv::Tracker> ();
+}
+
+CheeseTrackerPool::CheeseTrackerPool ()
+{
+  g_mutex_init (&_lock);
+}
+
+CheeseTrackerPool::~CheeseTrackerPool ()
+{
+  g_mutex_clear (&_lock);
+}
+
+/**
+ * Returns a tracker of @tracker_type, a spare one if there is any, ready to
+ * be initialised. It may be called from any thread.
+ **/
+cv::Ptr<cv::Tracker>
+CheeseTrackerPool::acquire (GstCheeseFaceTrackTrackerType tracker_type)
+{
+  cv::Ptr<cv::Tracker> tracker;
+
+  g_mutex_lock (&_lock);
+  std::vector<cv::Ptr<cv::Tracker> > & spares = _spares[tracker_type];
+  if (!spares.empty ()) {
+    tracker = spares.back ();
+    spares.pop_back ();
+  }
+  g_mutex_unlock (&_lock);
+
+  if (!tracker)
+    tracker = cheese_tracker_create (tracker_type);
+  return tracker;
+}
+
+/**
+ * Creates one spare tracker of @tracker_type if there are less than
+ * CHEESE_TRACKER_POOL_SPARES and drops those of other types, meant to be
+ * called once per frame.
+ **/
+void
+CheeseTrackerPool::refill (GstCheeseFaceTrackTrackerType tracker_type)
+{
+  cv::Ptr<cv::Tracker> tracker;
+  gboolean needed;
+
+  if (tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW ||
+      tracker_type == GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE)
+    needed = FALSE;
+  else {
+    g_mutex_lock (&_lock);
+    needed = _spares[tracker_type].size () < CHEESE_TRACKER_POOL_SPARES;
+    g_mutex_unlock (&_lock);
+  }
+  if (needed)
+    tracker = cheese_tracker_create (tracker_type);
+
+  g_mutex_lock (&_lock);
+  for (auto &kv : _spares) {
+    if (kv.first != tracker_type)
+      kv.second.clear ();
+  }
+  if (tracker)
+    _spares[tracker_type].push_back (tracker);
+  g_mutex_unlock (&_lock);
+}
+
+/* The filters of the batched MOSSE trackers. */
+CheeseMosse *
+CheeseTrackerPool::mosse ()
+{
+  return &_mosse;
+}
+
+static void
+cheese_faces_update_tracker_task (guint index, gpointer user_data)
+{
+  CheeseFaceTrackerBatch *batch = (CheeseFaceTrackerBatch *) user_data;
+
+  batch->found[index] = batch->faces[index]->update_tracker (*batch->frame,
+      batch->pyramid);
+}
+
+/**
+ * cheese_faces_update_trackers:
+ * @faces: the faces to track.
+ * @n_faces: the number of faces.
+ * @frame: the frame to track the faces in.
+ * @pyramid: (nullable): the optical flow pyramids of @frame, needed by the
+ *     shared median flow trackers.
+ * @max_threads: the maximum number of threads, 0 for one per processor.
+ * @found: @n_faces elements, filled with whether the target of each face
+ *     was found.
+ *
+ * Updates the trackers of all the faces using up to @max_threads threads.
+ */
+void
+cheese_faces_update_trackers (CheeseFace ** faces, guint n_faces,
+    cv::Mat & frame, CheeseFlowPyramid * pyramid, guint max_threads,
+    gboolean * found)
+{
+  CheeseFaceTrackerBatch batch;
+
+  batch.faces = faces;
+  batch.frame = &frame;
+  batch.pyramid = pyramid;
+  batch.found = found;
+  cheese_worker_pool_run (n_faces, max_threads,
+      cheese_faces_update_tracker_task, &batch);
 }
@@ -48,6 +48,14 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/tracking.hpp>
 
+#include <map>
+#include <vector>
+
+#include "flowpyramid.h"
+#include "kalman.h"
+#include "medianflow.h"
+#include "mosse.h"
+
 G_BEGIN_DECLS
 
 typedef enum {
@@ -56,7 +64,9 @@ typedef enum {
   GST_CHEESEFACETRACK_TRACKER_KCF,
   GST_CHEESEFACETRACK_TRACKER_MEDIANFLOW,
   GST_CHEESEFACETRACK_TRACKER_MIL,
-  GST_CHEESEFACETRACK_TRACKER_TLD
+  GST_CHEESEFACETRACK_TRACKER_TLD,
+  GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW,
+  GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE
 } GstCheeseFaceTrackTrackerType;
 
 typedef enum {
@@ -69,6 +79,32 @@ typedef enum {
 
 typedef void (* CheeseFaceFreeFunc) (gpointer);
 
+/* OpenCV trackers kept ready for the faces that lose their target. */
+#define CHEESE_TRACKER_POOL_SPARES          4
+
+/**
+ * Trackers of an element, keyed by type. An OpenCV tracker cannot be
+ * initialised twice, so instead of recycling them the pool creates spare ones
+ * ahead, at most one per frame, and a face that recovers its target takes a
+ * spare: many faces recovered in the same frame do not all create their
+ * trackers in it. The in-house trackers are reset in place, the MOSSE filters
+ * are slots of the pool and the median flow keeps its buffers in the face.
+ **/
+struct CheeseTrackerPool {
+  private:
+    GMutex _lock;
+    std::map<GstCheeseFaceTrackTrackerType,
+        std::vector<cv::Ptr<cv::Tracker> > > _spares;
+    CheeseMosse _mosse;
+
+  public:
+    CheeseTrackerPool ();
+    ~CheeseTrackerPool ();
+    cv::Ptr<cv::Tracker> acquire (GstCheeseFaceTrackTrackerType tracker_type);
+    void refill (GstCheeseFaceTrackTrackerType tracker_type);
+    CheeseMosse * mosse ();
+};
+
 struct CheeseFace {
   private:
     cv::Rect2d _bounding_box;
@@ -77,34 +113,70 @@ struct CheeseFace {
     gboolean _previous_bounding_box_exists;
     CheeseFaceInfoState _state;
     std::vector<cv::Point> _landmark;
+    /* Predicts the box on the frames the tracker has no target. */
+    CheeseKalmanBox _motion;
+    GstCheeseFaceTrackTrackerType _tracker_type;
+    /* The camera moved the face out of the reach of the tracker, and the
+     * last update started it again there without measuring anything. */
+    gboolean _restart_tracker;
+    gboolean _restarted;
+    /* Tracker of GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW. */
+    CheeseMedianFlow _median_flow;
+    /* Where the trackers come from and the MOSSE filter slot of the face,
+     * kept until the face is destroyed. */
+    CheeseTrackerPool *_pool;
+    gint _mosse_slot;
+    gdouble _confidence;
+
+    void coast ();
 
   public:
     /* TODO */
     /* Make these attributes private! */
     cv::Ptr<cv::Tracker> _tracker;
     guint tracking_duration;
+    /* Frames the landmark was last predicted and last placed, and the box
+     * it was placed in. */
+    guint landmark_predicted_frame;
+    guint landmark_frame;
+    cv::Rect2d landmark_bounding_box;
 
     gpointer user_data;
     CheeseFaceFreeFunc free_user_data_func;
 
     CheeseFace ();
     ~CheeseFace ();
+    /* A face owns its MOSSE slot and its user data, it is never copied:
+     * faces are built in place in their map. */
+    CheeseFace (const CheeseFace &) = delete;
+    CheeseFace & operator= (const CheeseFace &) = delete;
     GstCheeseFaceInfo * to_face_info_at_scale (gdouble scale_factor = 1.0);
-    gboolean update_tracker (cv::Mat & frame);
+    gboolean update_tracker (cv::Mat & frame, CheeseFlowPyramid * pyramid);
     cv::Point bounding_box_centroid ();
     cv::Point previous_bounding_box_centroid ();
     cv::Rect2d bounding_box ();
     guint last_detected_frame ();
     CheeseFaceInfoState state ();
     gboolean get_previous_bounding_box (cv::Rect2d & ret);
+    gdouble confidence ();
+    gboolean restarted ();
+    gdouble motion_gate_radius ();
+    gdouble follow_camera (const cv::Matx23d & motion,
+        gdouble restart_factor);
+    std::vector<cv::Point> & landmark ();
     void set_last_detected_frame (guint frame_number);
     void set_bounding_box (dlib::rectangle & rect);
     void set_landmark (std::vector<cv::Point> & landmark);
-    void create_tracker (GstCheeseFaceTrackTrackerType tracker_type);
+    void create_tracker (GstCheeseFaceTrackTrackerType tracker_type,
+        CheeseTrackerPool * pool);
     void init_tracker (cv::Mat & img);
     void release_tracker ();
 };
 
+void cheese_faces_update_trackers (CheeseFace ** faces, guint n_faces,
+    cv::Mat & frame, CheeseFlowPyramid * pyramid, guint max_threads,
+    gboolean * found);
+
 G_END_DECLS
 
 #endif /* __GSTCHEESEFACETRACK_INFO_H__ */
@@ -0,0 +1,99 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "flowpyramid.h"
+
+CheeseFlowPyramid::CheeseFlowPyramid ()
+{
+  _has_previous = FALSE;
+}
+
+/* Forgets the frames, there is no flow until two are given. */
+void
+CheeseFlowPyramid::reset ()
+{
+  _previous.clear ();
+  _current.clear ();
+  _has_previous = FALSE;
+}
+
+/* Builds the pyramid of @luma, which becomes the current frame. */
+void
+CheeseFlowPyramid::update (cv::Mat & luma)
+{
+  const cv::Size window (CHEESE_FLOW_PYRAMID_WINDOW,
+      CHEESE_FLOW_PYRAMID_WINDOW);
+
+  /* The levels are reused while the size stays. */
+  _previous.swap (_current);
+  _has_previous = !_previous.empty ();
+  cv::buildOpticalFlowPyramid (luma, _current, window,
+      CHEESE_FLOW_PYRAMID_LEVELS);
+  if (_has_previous && _previous[0].size () != _current[0].size ())
+    _has_previous = FALSE;
+}
+
+gboolean
+CheeseFlowPyramid::has_previous ()
+{
+  return _has_previous;
+}
+
+/* Size of the frames. */
+cv::Size
+CheeseFlowPyramid::size ()
+{
+  return _current.empty () ? cv::Size () : _current[0].size ();
+}
+
+std::vector<cv::Mat> &
+CheeseFlowPyramid::previous ()
+{
+  return _previous;
+}
+
+std::vector<cv::Mat> &
+CheeseFlowPyramid::current ()
+{
+  return _current;
+}
@@ -0,0 +1,81 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_FLOW_PYRAMID_H__
+#define __GSTCHEESEFACE_FLOW_PYRAMID_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+/* Largest optical flow window the pyramids can be used with. */
+#define CHEESE_FLOW_PYRAMID_WINDOW          15
+#define CHEESE_FLOW_PYRAMID_LEVELS          3
+
+/**
+ * Lucas-Kanade pyramids of the previous and the current luma frames. They
+ * are built once per frame and then only read, so every optical flow of the
+ * frame shares them from any thread.
+ **/
+struct CheeseFlowPyramid {
+  private:
+    std::vector<cv::Mat> _previous;
+    std::vector<cv::Mat> _current;
+    gboolean _has_previous;
+
+  public:
+    CheeseFlowPyramid ();
+    void reset ();
+    void update (cv::Mat & luma);
+    gboolean has_previous ();
+    cv::Size size ();
+    std::vector<cv::Mat> & previous ();
+    std::vector<cv::Mat> & current ();
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_FLOW_PYRAMID_H__ */
@@ -0,0 +1,323 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "gating.h"
+
+/* The grid is coarsened so it never has many more cells than columns. */
+#define CHEESE_GATING_CELLS_PER_COL       4
+#define CHEESE_GATING_MIN_CELLS           16
+
+void
+CheeseGatedAssignment::build_grid (const cv::Point * cols, guint n_cols,
+    gfloat cell_size)
+{
+  gfloat min_x, min_y, max_x, max_y;
+  gdouble n_cells, max_cells;
+  guint i;
+
+  min_x = max_x = cols[0].x;
+  min_y = max_y = cols[0].y;
+  for (i = 1; i < n_cols; i++) {
+    min_x = MIN (min_x, cols[i].x);
+    max_x = MAX (max_x, cols[i].x);
+    min_y = MIN (min_y, cols[i].y);
+    max_y = MAX (max_y, cols[i].y);
+  }
+
+  cell_size = MAX (cell_size, 1.0f);
+  max_cells = CHEESE_GATING_CELLS_PER_COL * n_cols + CHEESE_GATING_MIN_CELLS;
+  n_cells = (floor ((max_x - min_x) / cell_size) + 1) *
+      (floor ((max_y - min_y) / cell_size) + 1);
+  if (n_cells > max_cells)
+    cell_size *= sqrt (n_cells / max_cells);
+
+  _cell_size = cell_size;
+  _grid_origin = cv::Point2f (min_x, min_y);
+  _grid_cols = (gint) ((max_x - min_x) / cell_size) + 1;
+  _grid_rows = (gint) ((max_y - min_y) / cell_size) + 1;
+
+  /* Counting sort of the columns by cell. */
+  _cell_start.assign (_grid_cols * _grid_rows + 1, 0);
+  _cell_cols.resize (n_cols);
+  for (i = 0; i < n_cols; i++) {
+    gint cx = (gint) ((cols[i].x - min_x) / cell_size);
+    gint cy = (gint) ((cols[i].y - min_y) / cell_size);
+    _cell_start[cy * _grid_cols + cx + 1]++;
+  }
+  for (i = 1; i < _cell_start.size (); i++)
+    _cell_start[i] += _cell_start[i - 1];
+  for (i = 0; i < n_cols; i++) {
+    gint cx = (gint) ((cols[i].x - min_x) / cell_size);
+    gint cy = (gint) ((cols[i].y - min_y) / cell_size);
+    _cell_cols[_cell_start[cy * _grid_cols + cx]++] = i;
+  }
+  /* Each start was moved to the next one, shift them back. */
+  for (i = _cell_start.size () - 1; i > 0; i--)
+    _cell_start[i] = _cell_start[i - 1];
+  _cell_start[0] = 0;
+}
+
+/* Finds the columns within the radius of each row, and of the column. */
+void
+CheeseGatedAssignment::gate (const cv::Point * rows, const gfloat * radii,
+    guint n_rows, const cv::Point * cols, const gfloat * col_radii)
+{
+  guint r, k;
+  gint x, y;
+
+  _edge_start.resize (n_rows + 1);
+  _edge_cols.clear ();
+  _edge_costs.clear ();
+  for (r = 0; r < n_rows; r++) {
+    const gfloat radius = radii[r];
+    const gfloat px = rows[r].x - _grid_origin.x;
+    const gfloat py = rows[r].y - _grid_origin.y;
+    gint x0, x1, y0, y1;
+
+    _edge_start[r] = _edge_cols.size ();
+    if (radius <= 0)
+      continue;
+
+    x0 = MAX ((gint) floor ((px - radius) / _cell_size), 0);
+    x1 = MIN ((gint) floor ((px + radius) / _cell_size), _grid_cols - 1);
+    y0 = MAX ((gint) floor ((py - radius) / _cell_size), 0);
+    y1 = MIN ((gint) floor ((py + radius) / _cell_size), _grid_rows - 1);
+    for (y = y0; y <= y1; y++) {
+      for (x = x0; x <= x1; x++) {
+        const guint cell = y * _grid_cols + x;
+        for (k = _cell_start[cell]; k < _cell_start[cell + 1]; k++) {
+          const guint c = _cell_cols[k];
+          const gfloat dx = rows[r].x - cols[c].x;
+          const gfloat dy = rows[r].y - cols[c].y;
+          const gfloat dist2 = dx * dx + dy * dy;
+
+          if (dist2 < radius * radius &&
+              (!col_radii || dist2 < col_radii[c] * col_radii[c])) {
+            _edge_cols.push_back (c);
+            _edge_costs.push_back (sqrtf (dist2));
+          }
+        }
+      }
+    }
+  }
+  _edge_start[n_rows] = _edge_cols.size ();
+}
+
+guint
+CheeseGatedAssignment::find (guint node)
+{
+  while (_parent[node] != node) {
+    _parent[node] = _parent[_parent[node]];
+    node = _parent[node];
+  }
+  return node;
+}
+
+/* Groups the rows and the columns joined by gated pairs. */
+void
+CheeseGatedAssignment::split (guint n_rows, guint n_cols)
+{
+  const guint n_nodes = n_rows + n_cols;
+  guint r, k, node;
+
+  _parent.resize (n_nodes);
+  for (node = 0; node < n_nodes; node++)
+    _parent[node] = node;
+  for (r = 0; r < n_rows; r++) {
+    for (k = _edge_start[r]; k < _edge_start[r + 1]; k++) {
+      guint a = find (r);
+      guint b = find (n_rows + _edge_cols[k]);
+      if (a != b)
+        _parent[b] = a;
+    }
+  }
+
+  /* Number the groups, leaving out the nodes without pairs. */
+  _component.assign (n_nodes, -1);
+  n_components = 0;
+  for (r = 0; r < n_rows; r++) {
+    if (_edge_start[r] == _edge_start[r + 1])
+      continue;
+    node = find (r);
+    if (_component[node] == -1)
+      _component[node] = n_components++;
+    _component[r] = _component[node];
+  }
+  for (node = n_rows; node < n_nodes; node++)
+    _component[node] = _component[find (node)];
+
+  /* Counting sort of the nodes by group, rows come first since they have
+   * lower indices. */
+  _component_start.assign (n_components + 1, 0);
+  for (node = 0; node < n_nodes; node++) {
+    if (_component[node] != -1)
+      _component_start[_component[node] + 1]++;
+  }
+  for (k = 1; k <= n_components; k++)
+    _component_start[k] += _component_start[k - 1];
+  _members.resize (_component_start[n_components]);
+  for (node = 0; node < n_nodes; node++) {
+    if (_component[node] != -1)
+      _members[_component_start[_component[node]]++] = node;
+  }
+  for (k = n_components; k > 0; k--)
+    _component_start[k] = _component_start[k - 1];
+  _component_start[0] = 0;
+}
+
+/**
+ * Fills @assignment, of @n_rows elements, with the index of the column
+ * assigned to each row or -1 if none is closer than @radii of the row. When
+ * @col_radii is given, the columns must also be closer than their own
+ * radius. As many rows as possible are assigned, and then the total
+ * distance is the lowest.
+ **/
+void
+CheeseGatedAssignment::solve (const cv::Point * rows, const gfloat * radii,
+    guint n_rows, const cv::Point * cols, const gfloat * col_radii,
+    guint n_cols, gint * assignment)
+{
+  gfloat max_radius = 0;
+  guint i, k, n;
+
+  n_pairs = 0;
+  n_components = 0;
+  for (i = 0; i < n_rows; i++)
+    assignment[i] = -1;
+  if (n_rows == 0 || n_cols == 0)
+    return;
+
+  for (i = 0; i < n_rows; i++)
+    max_radius = MAX (max_radius, radii[i]);
+  build_grid (cols, n_cols, max_radius);
+  gate (rows, radii, n_rows, cols, col_radii);
+  n_pairs = _edge_cols.size ();
+  split (n_rows, n_cols);
+
+  _local.resize (n_cols);
+  for (n = 0; n < n_components; n++) {
+    const guint *members = &_members[_component_start[n]];
+    const guint n_members = _component_start[n + 1] - _component_start[n];
+    guint n_group_rows = 0;
+
+    while (n_group_rows < n_members && members[n_group_rows] < n_rows)
+      n_group_rows++;
+
+    /* A single pair, nothing to solve. */
+    if (n_members == 2) {
+      assignment[members[0]] = members[1] - n_rows;
+      continue;
+    }
+
+    for (i = n_group_rows; i < n_members; i++)
+      _local[members[i] - n_rows] = i - n_group_rows;
+    _solver.resize (n_group_rows, n_members - n_group_rows);
+    for (i = 0; i < n_group_rows; i++) {
+      const guint r = members[i];
+      gfloat *costs = _solver.row (i);
+
+      for (k = 0; k < _solver.cols (); k++)
+        costs[k] = CHEESE_ASSIGNMENT_FORBIDDEN;
+      for (k = _edge_start[r]; k < _edge_start[r + 1]; k++)
+        costs[_local[_edge_cols[k]]] = _edge_costs[k];
+    }
+
+    _sub_assignment.resize (n_group_rows);
+    _solver.solve (_sub_assignment.data ());
+    for (i = 0; i < n_group_rows; i++) {
+      if (_sub_assignment[i] != -1)
+        assignment[members[i]] =
+            members[n_group_rows + _sub_assignment[i]] - n_rows;
+    }
+  }
+}
+
+/**
+ * Like solve (), then pairs the rows left with the columns left whatever
+ * their distance, with the lowest total distance. @far, of @n_rows elements,
+ * is set to TRUE for the rows paired that way.
+ **/
+void
+CheeseGatedAssignment::solve_far (const cv::Point * rows,
+    const gfloat * radii, guint n_rows, const cv::Point * cols,
+    const gfloat * col_radii, guint n_cols, gint * assignment,
+    gboolean * far)
+{
+  guint i, k;
+
+  solve (rows, radii, n_rows, cols, col_radii, n_cols, assignment);
+  for (i = 0; i < n_rows; i++)
+    far[i] = FALSE;
+
+  _far_rows.clear ();
+  _far_cols.clear ();
+  _used_cols.assign (n_cols, FALSE);
+  for (i = 0; i < n_rows; i++) {
+    if (assignment[i] == -1)
+      _far_rows.push_back (i);
+    else
+      _used_cols[assignment[i]] = TRUE;
+  }
+  for (k = 0; k < n_cols; k++) {
+    if (!_used_cols[k])
+      _far_cols.push_back (k);
+  }
+  if (_far_rows.empty () || _far_cols.empty ())
+    return;
+
+  _solver.resize (_far_rows.size (), _far_cols.size ());
+  for (i = 0; i < _far_rows.size (); i++) {
+    gfloat *costs = _solver.row (i);
+
+    for (k = 0; k < _far_cols.size (); k++)
+      costs[k] = cv::norm (rows[_far_rows[i]] - cols[_far_cols[k]]);
+  }
+  _sub_assignment.resize (_far_rows.size ());
+  _solver.solve (_sub_assignment.data ());
+  for (i = 0; i < _far_rows.size (); i++) {
+    if (_sub_assignment[i] != -1) {
+      assignment[_far_rows[i]] = _far_cols[_sub_assignment[i]];
+      far[_far_rows[i]] = TRUE;
+    }
+  }
+}
@@ -0,0 +1,118 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_GATING_H__
+#define __GSTCHEESEFACE_GATING_H__
+
+#include <glib.h>
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+#include "assignment.h"
+
+G_BEGIN_DECLS
+
+/**
+ * Assigns points to points by distance, only pairing those that are closer
+ * than the radius of the row. The columns are put in a uniform grid so each
+ * row only looks at the cells around it, and the gated pairs split the
+ * problem into independent groups which are solved one by one. With faces
+ * spread over the frame the groups stay small, so the cost grows about
+ * linearly with the number of faces instead of cubically.
+ **/
+struct CheeseGatedAssignment {
+  private:
+    CheeseAssignment _solver;
+
+    /* Uniform grid over the columns. _cell_start has an extra element, and
+     * the columns of the cell i are _cell_cols[_cell_start[i] ...
+     * _cell_start[i + 1]). */
+    gfloat _cell_size;
+    cv::Point2f _grid_origin;
+    gint _grid_cols;
+    gint _grid_rows;
+    std::vector<guint> _cell_start;
+    std::vector<guint> _cell_cols;
+
+    /* Gated pairs, grouped by row in the same way. */
+    std::vector<guint> _edge_start;
+    std::vector<guint> _edge_cols;
+    std::vector<gfloat> _edge_costs;
+
+    /* Union-find over the rows followed by the columns, and the nodes of
+     * each group, rows first. */
+    std::vector<guint> _parent;
+    std::vector<gint> _component;
+    std::vector<guint> _component_start;
+    std::vector<guint> _members;
+    std::vector<gint> _local;
+    std::vector<gint> _sub_assignment;
+
+    /* Rows and columns left by the gated pairs. */
+    std::vector<guint> _far_rows;
+    std::vector<guint> _far_cols;
+    std::vector<gboolean> _used_cols;
+
+    void build_grid (const cv::Point * cols, guint n_cols, gfloat cell_size);
+    void gate (const cv::Point * rows, const gfloat * radii, guint n_rows,
+        const cv::Point * cols, const gfloat * col_radii);
+    guint find (guint node);
+    void split (guint n_rows, guint n_cols);
+
+  public:
+    /* Statistics of the last call. */
+    guint n_pairs;
+    guint n_components;
+
+    void solve (const cv::Point * rows, const gfloat * radii, guint n_rows,
+        const cv::Point * cols, const gfloat * col_radii, guint n_cols,
+        gint * assignment);
+    void solve_far (const cv::Point * rows, const gfloat * radii,
+        guint n_rows, const cv::Point * cols, const gfloat * col_radii,
+        guint n_cols, gint * assignment, gboolean * far);
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_GATING_H__ */
@@ -72,13 +72,28 @@
 #include <vector>
 
 #include "gstcheesefacedetect.h"
+#include "utils.h"
+#include "videoframe.h"
+#include "workerpool.h"
 
 using namespace std;
 using namespace dlib;
 
 
 #define DEFAULT_HUNGARIAN_DELETE_THRESHOLD                72
+#define DEFAULT_DISTANCE_FACTOR                           3.0
 #define DEFAULT_SCALE_FACTOR                              1.0
+#define DEFAULT_COARSE_SCALE_FACTOR                       0.0
+#define DEFAULT_ASYNC                                     FALSE
+#define DEFAULT_PIPELINE_DEPTH                            0
+#define DEFAULT_TILE_SIZE                                 0
+#define DEFAULT_TILE_OVERLAP                              160
+#define DEFAULT_FULL_SCAN_INTERVAL                        0
+#define DEFAULT_MOTION_THRESHOLD                          0.0
+
+/* Margin added on each side of a face, relative to its size, to get the
+ * window it is searched in when the full frame is not scanned. */
+#define ROI_MARGIN                                        0.5
 
 GST_DEBUG_CATEGORY_STATIC (gst_cheese_face_detect_debug);
 #define GST_CAT_DEFAULT gst_cheese_face_detect_debug
@@ -101,8 +116,16 @@ enum
   PROP_LANDMARK,
   PROP_USE_HUNGARIAN,
   PROP_HUNGARIAN_DELETE_THRESHOLD,
+  PROP_DISTANCE_FACTOR,
   PROP_USE_POSE_ESTIMATION,
-  PROP_SCALE_FACTOR
+  PROP_SCALE_FACTOR,
+  PROP_COARSE_SCALE_FACTOR,
+  PROP_ASYNC,
+  PROP_PIPELINE_DEPTH,
+  PROP_TILE_SIZE,
+  PROP_TILE_OVERLAP,
+  PROP_FULL_SCAN_INTERVAL,
+  PROP_MOTION_THRESHOLD
 };
 
 // static dlib::frontal_face_detector mydetector = get_frontal_face_detector();
@@ -114,13 +137,13 @@ enum
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGB"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (CHEESE_VIDEO_FRAME_FORMATS))
     );
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGB"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (CHEESE_VIDEO_FRAME_FORMATS))
     );
 
 #define gst_cheese_face_detect_parent_class parent_class
@@ -132,8 +155,23 @@ static void gst_cheese_face_detect_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
 static void gst_cheese_face_detect_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
+static gboolean gst_cheese_face_detect_stop (GstBaseTransform * trans);
+static gboolean gst_cheese_face_detect_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static gboolean gst_cheese_face_detect_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query);
+static GstFlowReturn gst_cheese_face_detect_submit_input_buffer (
+    GstBaseTransform * trans, gboolean is_discont, GstBuffer * input);
+static GstFlowReturn gst_cheese_face_detect_generate_output (
+    GstBaseTransform * trans, GstBuffer ** outbuf);
+static gboolean gst_cheese_face_detect_set_info (GstVideoFilter * vfilter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static GstFlowReturn gst_cheese_face_detect_transform_frame_ip (
+    GstVideoFilter * vfilter, GstVideoFrame * frame);
 static GstFlowReturn gst_cheese_face_detect_transform_ip (
     GstOpencvVideoFilter * filter, GstBuffer * buf, cv::Mat img);
+static void gst_cheese_face_detect_async_stop (GstCheeseFaceDetect * filter);
 
 /* GObject vmethod implementations */
 
@@ -143,6 +181,8 @@ gst_cheese_face_detect_class_init (GstCheeseFaceDetectClass * klass)
 {
   GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
+  GstBaseTransformClass *gstbasetransform_class;
+  GstVideoFilterClass *gstvideofilter_class;
   GstOpencvVideoFilterClass *gstopencvbasefilter_class;
 
   GST_DEBUG_CATEGORY_INIT (gst_cheese_face_detect_debug, "gstcheesefacedetect",
@@ -152,8 +192,23 @@ gst_cheese_face_detect_class_init (GstCheeseFaceDetectClass * klass)
 
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
+  gstbasetransform_class = (GstBaseTransformClass *) klass;
+  gstvideofilter_class = (GstVideoFilterClass *) klass;
   gstopencvbasefilter_class = (GstOpencvVideoFilterClass *) klass;
 
+  gstbasetransform_class->stop = GST_DEBUG_FUNCPTR (gst_cheese_face_detect_stop);
+  gstbasetransform_class->sink_event =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_detect_sink_event);
+  gstbasetransform_class->query =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_detect_query);
+  gstbasetransform_class->submit_input_buffer =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_detect_submit_input_buffer);
+  gstbasetransform_class->generate_output =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_detect_generate_output);
+  gstvideofilter_class->set_info =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_detect_set_info);
+  gstvideofilter_class->transform_frame_ip =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_detect_transform_frame_ip);
   gstopencvbasefilter_class->cv_trans_ip_func =
       gst_cheese_face_detect_transform_ip;
 
@@ -196,6 +251,15 @@ gst_cheese_face_detect_class_init (GstCheeseFaceDetectClass * klass)
           0, G_MAXUINT,
           DEFAULT_HUNGARIAN_DELETE_THRESHOLD,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class,
+      PROP_DISTANCE_FACTOR,
+      g_param_spec_double ("max-distance-factor", "Max distance factor",
+          "Sets the maximum distance a face can move between detections to "
+          "be matched again, in relation to its bounding box width. Faces "
+          "that are farther are only compared with their neighbours, which "
+          "keeps matching fast in crowds.",
+          0.0, G_MAXDOUBLE, DEFAULT_DISTANCE_FACTOR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
   g_object_class_install_property (gobject_class, PROP_USE_POSE_ESTIMATION,
       g_param_spec_boolean ("use-pose-estimation", "Pose estimation",
           "Sets whether to use estimate the pose of each face.",
@@ -207,6 +271,62 @@ gst_cheese_face_detect_class_init (GstCheeseFaceDetectClass * klass)
           0, G_MAXFLOAT,
           DEFAULT_SCALE_FACTOR,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_COARSE_SCALE_FACTOR,
+      g_param_spec_float ("coarse-scale-factor", "Coarse scale factor",
+          "Sets the scale factor of the frame candidate faces are searched "
+          "in. The candidates are then detected again, and their landmark "
+          "estimated, in full resolution crops around them. scale-factor is "
+          "ignored in this mode. 0 disables it.",
+          0, 1, DEFAULT_COARSE_SCALE_FACTOR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_ASYNC,
+      g_param_spec_boolean ("async", "Asynchronous detection",
+          "Sets whether to run the face detection in a background thread. "
+          "Frames pass through immediately and carry the most recent result, "
+          "which may have been computed on an earlier frame.",
+          DEFAULT_ASYNC,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_PIPELINE_DEPTH,
+      g_param_spec_uint ("pipeline-depth", "Pipeline depth",
+          "Sets the number of frames held back to pipeline the face detection "
+          "of a frame with the landmark and pose estimation of the previous "
+          "one on separate threads. Each frame keeps its own metadata and the "
+          "added latency is reported. Subclasses still draw on every frame, "
+          "from the second thread. 0 disables the pipelined mode.",
+          0, G_MAXUINT, DEFAULT_PIPELINE_DEPTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TILE_SIZE,
+      g_param_spec_uint ("tile-size", "Tile size",
+          "Sets the size in pixels of the square tiles the scaled frame is "
+          "split into, each tile is scanned for faces on its own core. "
+          "Sizes below the 80 pixels of the detection window are raised to "
+          "it. 0 scans the whole frame at once.",
+          0, G_MAXUINT, DEFAULT_TILE_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TILE_OVERLAP,
+      g_param_spec_uint ("tile-overlap", "Tile overlap",
+          "Sets the overlap in pixels between neighbouring tiles. Faces "
+          "bigger than the overlap may be cut by a tile seam.",
+          0, G_MAXUINT, DEFAULT_TILE_OVERLAP,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_FULL_SCAN_INTERVAL,
+      g_param_spec_uint ("full-scan-interval", "Full scan interval",
+          "Sets every how many frames the whole frame is scanned for faces. "
+          "In the frames in between faces are only searched in windows "
+          "around the known ones, enlarged by their motion. The whole frame "
+          "is also scanned when a face is lost. 0 always scans the whole "
+          "frame.",
+          0, G_MAXUINT, DEFAULT_FULL_SCAN_INTERVAL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MOTION_THRESHOLD,
+      g_param_spec_double ("motion-threshold", "Motion threshold",
+          "Sets the mean luma difference, from 0 to 255, above which a tile "
+          "of the frame is considered changed. Only the changed tiles, and "
+          "a margin around them, are scanned for faces. The faces found "
+          "elsewhere are kept from the previous scans. 0 scans the whole "
+          "frame.",
+          0.0, 255.0, DEFAULT_MOTION_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
 
   gst_element_class_set_details_simple(gstelement_class,
@@ -230,17 +350,50 @@ gst_cheese_face_detect_init (GstCheeseFaceDetect * filter)
   filter->use_hungarian = TRUE;
   filter->use_pose_estimation = TRUE;
   filter->hungarian_delete_threshold = DEFAULT_HUNGARIAN_DELETE_THRESHOLD;
+  filter->distance_factor = DEFAULT_DISTANCE_FACTOR;
   filter->display_bounding_box = TRUE;
   filter->display_id = TRUE;
   filter->display_pose_estimation = TRUE;
   filter->landmark = NULL;
-  filter->face_detector =
-      new frontal_face_detector (get_frontal_face_detector());
-  filter->shape_predictor = NULL;
+  filter->face_detector = new CheeseFaceDetector ();
+  filter->shape_predictor = new std::shared_ptr<dlib::shape_predictor>;
   filter->scale_factor = DEFAULT_SCALE_FACTOR;
+  filter->coarse_scale_factor = DEFAULT_COARSE_SCALE_FACTOR;
+  filter->async = DEFAULT_ASYNC;
 
   filter->faces = new std::map<guint, CheeseFace>;
 
+  g_mutex_init (&filter->async_lock);
+  g_cond_init (&filter->async_cond);
+  filter->async_thread = NULL;
+  filter->async_stop = FALSE;
+  filter->async_job = NULL;
+  filter->async_result = NULL;
+  filter->async_removed_faces = g_array_new (FALSE, FALSE, sizeof (guint));
+  filter->async_result_pts = GST_CLOCK_TIME_NONE;
+
+  filter->pipeline_depth = DEFAULT_PIPELINE_DEPTH;
+  filter->tile_size = DEFAULT_TILE_SIZE;
+  filter->tile_overlap = DEFAULT_TILE_OVERLAP;
+  filter->full_scan_interval = DEFAULT_FULL_SCAN_INTERVAL;
+  filter->motion_threshold = DEFAULT_MOTION_THRESHOLD;
+  filter->motion_gate = new CheeseMotionGate ();
+  filter->luma_scaler = new CheeseLumaScaler ();
+  filter->scratch_pool = new CheeseScratchPool ();
+  filter->arena = new CheeseArena ();
+  filter->assignment = new CheeseGatedAssignment ();
+
+  g_mutex_init (&filter->roi_lock);
+  filter->roi_windows = new std::vector<cv::Rect>;
+  filter->roi_full_scan = TRUE;
+  filter->roi_frames = 0;
+  filter->pipeline_detect_pool = NULL;
+  filter->pipeline_update_pool = NULL;
+  g_mutex_init (&filter->pipeline_lock);
+  g_cond_init (&filter->pipeline_cond);
+  filter->pipeline_jobs = g_queue_new ();
+  filter->pipeline_job = NULL;
+
   filter->pose_model_points = new std::vector<cv::Point3d>;
 
   filter->camera_matrix = NULL;
@@ -263,12 +416,43 @@ gst_cheese_face_detect_init (GstCheeseFaceDetect * filter)
       TRUE);
 }
 
+/* Loads the landmark model at @path. The jobs being processed keep the model
+ * they were queued with. */
+static void
+gst_cheese_face_detect_set_landmark (GstCheeseFaceDetect * filter,
+    const gchar * path)
+{
+  std::shared_ptr<dlib::shape_predictor> predictor (new dlib::shape_predictor);
+
+  try {
+    dlib::deserialize (path) >> *predictor;
+  } catch (dlib::serialization_error &e) {
+    GST_ERROR ("Error when deserializing landmark predictor model: %s",
+        e.info.c_str());
+    predictor.reset ();
+  }
+
+  GST_OBJECT_LOCK (filter);
+  g_free (filter->landmark);
+  filter->landmark = g_strdup (path);
+  filter->shape_predictor->swap (predictor);
+  GST_OBJECT_UNLOCK (filter);
+}
+
 static void
 gst_cheese_face_detect_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (object);
+  gboolean latency_changed = FALSE;
 
+  /* Loading a model takes long, it is not done under the lock. */
+  if (prop_id == PROP_LANDMARK) {
+    gst_cheese_face_detect_set_landmark (filter, g_value_get_string (value));
+    return;
+  }
+
+  GST_OBJECT_LOCK (filter);
   switch (prop_id) {
     case PROP_DISPLAY_BOUNDING_BOX:
       filter->display_bounding_box = g_value_get_boolean (value);
@@ -282,34 +466,59 @@ gst_cheese_face_detect_set_property (GObject * object, guint prop_id,
     case PROP_DISPLAY_POSE_ESTIMATION:
       filter->display_pose_estimation = g_value_get_boolean (value);
       break;
-    case PROP_LANDMARK:
-      filter->landmark = g_value_dup_string (value);
-      filter->shape_predictor = new dlib::shape_predictor;
-      try {
-        dlib::deserialize (filter->landmark) >> *filter->shape_predictor;
-      } catch (dlib::serialization_error &e) {
-        GST_ERROR ("Error when deserializing landmark predictor model: %s",
-            e.info.c_str());
-        delete filter->shape_predictor;
-        filter->shape_predictor = NULL;
-      }
-      break;
     case PROP_USE_HUNGARIAN:
       filter->use_hungarian = g_value_get_boolean (value);
       break;
     case PROP_HUNGARIAN_DELETE_THRESHOLD:
       filter->hungarian_delete_threshold = g_value_get_uint (value);
       break;
+    case PROP_DISTANCE_FACTOR:
+      filter->distance_factor = g_value_get_double (value);
+      break;
     case PROP_USE_POSE_ESTIMATION:
       filter->use_pose_estimation = g_value_get_boolean (value);
       break;
     case PROP_SCALE_FACTOR:
       filter->scale_factor = g_value_get_float (value);
       break;
+    case PROP_COARSE_SCALE_FACTOR:
+      filter->coarse_scale_factor = g_value_get_float (value);
+      break;
+    case PROP_ASYNC:
+      filter->async = g_value_get_boolean (value);
+      break;
+    case PROP_PIPELINE_DEPTH:
+      filter->pipeline_depth = g_value_get_uint (value);
+      latency_changed = TRUE;
+      break;
+    case PROP_TILE_SIZE:
+      /* A tile smaller than the detection window never holds a face. */
+      filter->tile_size = g_value_get_uint (value);
+      if (filter->tile_size > 0)
+        filter->tile_size = MAX (filter->tile_size,
+            CHEESE_FACE_DETECTOR_WINDOW_SIZE);
+      break;
+    case PROP_TILE_OVERLAP:
+      filter->tile_overlap = g_value_get_uint (value);
+      break;
+    case PROP_FULL_SCAN_INTERVAL:
+      filter->full_scan_interval = g_value_get_uint (value);
+      g_mutex_lock (&filter->roi_lock);
+      filter->roi_full_scan = TRUE;
+      g_mutex_unlock (&filter->roi_lock);
+      break;
+    case PROP_MOTION_THRESHOLD:
+      filter->motion_threshold = g_value_get_double (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK (filter);
+
+  if (latency_changed)
+    gst_element_post_message (GST_ELEMENT (filter),
+        gst_message_new_latency (GST_OBJECT (filter)));
 }
 
 static void
@@ -318,6 +527,7 @@ gst_cheese_face_detect_get_property (GObject * object, guint prop_id,
 {
   GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (object);
 
+  GST_OBJECT_LOCK (filter);
   switch (prop_id) {
     case PROP_DISPLAY_BOUNDING_BOX:
       g_value_set_boolean (value, filter->display_bounding_box);
@@ -340,35 +550,88 @@ gst_cheese_face_detect_get_property (GObject * object, guint prop_id,
     case PROP_HUNGARIAN_DELETE_THRESHOLD:
       g_value_set_uint (value, filter->hungarian_delete_threshold);
       break;
+    case PROP_DISTANCE_FACTOR:
+      g_value_set_double (value, filter->distance_factor);
+      break;
     case PROP_USE_POSE_ESTIMATION:
       g_value_set_boolean (value, filter->use_pose_estimation);
       break;
     case PROP_SCALE_FACTOR:
       g_value_set_float (value, filter->scale_factor);
+      break;
+    case PROP_COARSE_SCALE_FACTOR:
+      g_value_set_float (value, filter->coarse_scale_factor);
+      break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, filter->async);
+      break;
+    case PROP_PIPELINE_DEPTH:
+      g_value_set_uint (value, filter->pipeline_depth);
+      break;
+    case PROP_TILE_SIZE:
+      g_value_set_uint (value, filter->tile_size);
+      break;
+    case PROP_TILE_OVERLAP:
+      g_value_set_uint (value, filter->tile_overlap);
+      break;
+    case PROP_FULL_SCAN_INTERVAL:
+      g_value_set_uint (value, filter->full_scan_interval);
+      break;
+    case PROP_MOTION_THRESHOLD:
+      g_value_set_double (value, filter->motion_threshold);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK (filter);
+}
+
+static void
+gst_cheese_face_detect_job_init (GstCheeseFaceDetect * filter,
+    CheeseFaceDetectJob & job, GstBuffer * buf, cv::Mat & img)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (filter);
+  CheeseFaceDetectSettings & settings = job.settings;
+
+  GST_OBJECT_LOCK (filter);
+  settings.display_bounding_box = filter->display_bounding_box;
+  settings.display_id = filter->display_id;
+  settings.display_landmark = filter->display_landmark;
+  settings.display_pose_estimation = filter->display_pose_estimation;
+  settings.use_hungarian = filter->use_hungarian;
+  settings.use_pose_estimation = filter->use_pose_estimation;
+  settings.hungarian_delete_threshold = filter->hungarian_delete_threshold;
+  settings.distance_factor = filter->distance_factor;
+  settings.scale_factor = filter->scale_factor;
+  settings.coarse_scale_factor = filter->coarse_scale_factor;
+  settings.tile_size = filter->tile_size;
+  settings.tile_overlap = filter->tile_overlap;
+  settings.full_scan_interval = filter->full_scan_interval;
+  settings.motion_threshold = filter->motion_threshold;
+  settings.shape_predictor = *filter->shape_predictor;
+  GST_OBJECT_UNLOCK (filter);
+
+  job.frame = img;
+  job.pts = GST_BUFFER_PTS (buf);
+  job.duration = GST_BUFFER_DURATION (buf);
+  job.running_time = gst_segment_to_running_time (&trans->segment,
+      GST_FORMAT_TIME, job.pts);
+  job.stream_time = gst_segment_to_stream_time (&trans->segment,
+      GST_FORMAT_TIME, job.pts);
 }
 
 static GstMessage *
 gst_cheese_face_detect_message_new (GstCheeseFaceDetect * filter,
-    GstBuffer * buf)
+    CheeseFaceDetectJob & job)
 {
-  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (filter);
   GstStructure *s;
-  GstClockTime running_time, stream_time;
-
-  running_time = gst_segment_to_running_time (&trans->segment, GST_FORMAT_TIME,
-      GST_BUFFER_TIMESTAMP (buf));
-  stream_time = gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
-      GST_BUFFER_TIMESTAMP (buf));
 
   s = gst_structure_new ("cheesefacedetect",
-      "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (buf),
-      "stream-time", G_TYPE_UINT64, stream_time,
-      "running-time", G_TYPE_UINT64, running_time,
-      "duration", G_TYPE_UINT64, GST_BUFFER_DURATION (buf), NULL);
+      "timestamp", G_TYPE_UINT64, job.pts,
+      "stream-time", G_TYPE_UINT64, job.stream_time,
+      "running-time", G_TYPE_UINT64, job.running_time,
+      "duration", G_TYPE_UINT64, job.duration, NULL);
 
   return gst_message_new_element (GST_OBJECT (filter), s);
 }
@@ -430,98 +693,289 @@ cv::Mat rot2euler(const cv::Mat & rotationMatrix)
   return euler;
 }
 
-/* chain function
- * this function does the actual processing
+/* Gives the windows, in the coordinates of the scaled frame of the job, the
+ * faces should be searched in. Returns FALSE if the whole frame has to be
+ * scanned instead.
  */
-static GstFlowReturn
-gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
-    GstBuffer * buf, cv::Mat cvImg)
+static gboolean
+gst_cheese_face_detect_get_roi_windows (GstCheeseFaceDetect * filter,
+    CheeseFaceDetectJob & job, std::vector<cv::Rect> & windows)
 {
-  guint i, j;
-  GValue faces_values = G_VALUE_INIT;
-  GstMessage *msg;
-  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (base);
-  GstCheeseFaceDetectClass *klass = GST_CHEESEFACEDETECT_GET_CLASS (filter);
-  /* TODO */
-  /* Handle more cases for posting messages like gstfacedetect. */
-  gboolean post_msg = TRUE;
-  cv::Mat resizedImg;
-  cv_image<bgr_pixel> dlib_img;
-  gboolean debug = gst_debug_is_active ();
-  gint64 start, end;
-  gint64 time_scale_down, time_hungarian, time_face_detection, time_scale_up;
-  gint64 time_pose_estimation, time_landmark, time_others, time_total;
-  gint64 time_post;
-  GstCheeseMultifaceMeta *multiface_meta;
+  cv::Rect bounds (0, 0, job.resized_frame.cols, job.resized_frame.rows);
+  gboolean full_scan;
+  guint i;
+
+  if (job.settings.full_scan_interval == 0)
+    return FALSE;
+
+  g_mutex_lock (&filter->roi_lock);
+  full_scan = filter->roi_full_scan ||
+      ++filter->roi_frames >= job.settings.full_scan_interval;
+  if (full_scan) {
+    filter->roi_frames = 0;
+  } else {
+    for (i = 0; i < filter->roi_windows->size (); i++) {
+      const cv::Rect & window = (*filter->roi_windows)[i];
+      cv::Rect scaled (window.x * job.scale_factor,
+          window.y * job.scale_factor, window.width * job.scale_factor,
+          window.height * job.scale_factor);
+      scaled &= bounds;
+      if (scaled.area () > 0)
+        windows.push_back (scaled);
+    }
+  }
+  g_mutex_unlock (&filter->roi_lock);
 
-  time_scale_down = time_hungarian = time_face_detection = time_scale_up =
-      time_pose_estimation = time_landmark = time_post = -1;
+  if (full_scan)
+    GST_LOG ("Scanning the whole frame.");
 
-  multiface_meta = gst_buffer_add_cheese_multiface_meta (buf);
+  return !full_scan;
+}
 
-  if (debug)
-    time_total = cv::getTickCount ();
-  GST_LOG ("Frame size: %d (height) x %d (width).", cvImg.rows, cvImg.cols);
+/* Places the detection window of each face where it is expected in the next
+ * frame. If a face was not found in this frame the next one is scanned
+ * entirely.
+ */
+static void
+gst_cheese_face_detect_update_roi_windows (GstCheeseFaceDetect * filter)
+{
+  std::vector<cv::Rect> windows;
+  gboolean full_scan = filter->faces->empty ();
 
-  if (post_msg)
-    time_post = 0;
+  for (auto &kv : *filter->faces) {
+    CheeseFace &face = kv.second;
+    gdouble margin_x, margin_y;
+    cv::Point center;
 
-  if (post_msg) {
-    if (debug)
-      start = cv::getTickCount ();
-    msg = gst_cheese_face_detect_message_new (filter, buf);
-    g_value_init (&faces_values, GST_TYPE_LIST);
-    if (debug) {
-      end = cv::getTickCount ();
-      time_post += end - start;
+    if (face.last_detected_frame != filter->frame_number) {
+      GST_LOG ("Face %d was lost, the next frame will be fully scanned.",
+          kv.first);
+      full_scan = TRUE;
+      break;
     }
+
+    margin_x = face.bounding_box.width () * ROI_MARGIN + ABS (face.motion.x);
+    margin_y = face.bounding_box.height () * ROI_MARGIN + ABS (face.motion.y);
+    center = face.centroid + face.motion;
+    windows.push_back (cv::Rect (
+        center.x - face.bounding_box.width () / 2 - margin_x,
+        center.y - face.bounding_box.height () / 2 - margin_y,
+        face.bounding_box.width () + 2 * margin_x,
+        face.bounding_box.height () + 2 * margin_y));
   }
 
-  /* Scale the frame */
-  if (filter->scale_factor != 1.0) {
-    if (debug)
-      start = cv::getTickCount ();
-    cv::resize(cvImg, resizedImg, cv::Size(cvImg.cols * filter->scale_factor,
-        cvImg.rows * filter->scale_factor));
-    if (debug) {
-      end = cv::getTickCount ();
-      time_scale_down = end - start;
-    }
-    GST_LOG ("Image scaled by the factor %.2f. New image processing size: "
-        "%d (height) x %d (width).", filter->scale_factor,
-        resizedImg.rows, resizedImg.cols);
-    dlib_img = cv_image<bgr_pixel> (resizedImg);
-  } else
-    dlib_img = cv_image<bgr_pixel> (cvImg);
+  g_mutex_lock (&filter->roi_lock);
+  filter->roi_windows->swap (windows);
+  filter->roi_full_scan = full_scan;
+  g_mutex_unlock (&filter->roi_lock);
+}
+
+/* Scales the frame of the job and runs the face detector on it. The
+ * detections are stored in the job in the coordinates of the original frame.
+ */
+static void
+gst_cheese_face_detect_detect_faces (GstCheeseFaceDetect * filter,
+    CheeseFaceDetectJob & job)
+{
+  guint i;
+  std::vector<cv::Rect> windows;
+  const CheeseFaceDetectSettings & settings = job.settings;
+  gboolean debug = gst_debug_is_active ();
+  gint64 start;
+
+  GST_LOG ("Frame size: %d (height) x %d (width).", job.frame.rows,
+      job.frame.cols);
 
-  /* start = chrono::steady_clock::now(); */
+  /* In the coarse to fine mode the faces are refined at full resolution. */
+  if (settings.coarse_scale_factor > 0.0)
+    job.scale_factor = 1.0;
+  else
+    job.scale_factor = settings.scale_factor;
+
+  /* Convert to luma and scale the frame */
   if (debug)
     start = cv::getTickCount ();
-  std::vector<rectangle> dets = (*filter->face_detector) (dlib_img);
-  if (debug) {
-    end = cv::getTickCount ();
-    time_face_detection = end - start;
-  }
+  job.resized_frame = filter->luma_scaler->scale (job.frame, job.scale_factor);
+  if (debug)
+    GST_DEBUG ("Time to scale down frame: %.2f ms.",
+        ((double) (cv::getTickCount () - start) * 1000) /
+            cv::getTickFrequency());
+  GST_LOG ("Image scaled by the factor %.2f. New image processing size: "
+      "%d (height) x %d (width).", job.scale_factor,
+      job.resized_frame.rows, job.resized_frame.cols);
+
+  /* The motion gate starts over whenever it is enabled again. */
+  if (settings.motion_threshold == 0.0 || settings.coarse_scale_factor > 0.0)
+    filter->motion_gate->reset ();
+
+  if (debug)
+    start = cv::getTickCount ();
+  if (gst_cheese_face_detect_get_roi_windows (filter, job, windows)) {
+    GST_LOG ("Searching faces in %d windows.", (gint) windows.size ());
+    job.dets = filter->face_detector->detect_regions (job.resized_frame,
+        windows);
+  } else if (settings.coarse_scale_factor > 0.0) {
+    job.dets = filter->face_detector->detect_coarse_to_fine (job.resized_frame,
+        settings.coarse_scale_factor);
+  } else if (settings.motion_threshold > 0.0) {
+    filter->motion_gate->threshold = settings.motion_threshold;
+    job.dets = filter->motion_gate->detect (*filter->face_detector,
+        job.resized_frame);
+  } else if (settings.tile_size > 0) {
+    job.dets = filter->face_detector->detect_tiles (job.resized_frame,
+        settings.tile_size, settings.tile_overlap);
+  } else
+    job.dets = filter->face_detector->detect (job.resized_frame);
+  if (debug)
+    GST_DEBUG ("Time to detect a face: %.2f ms.",
+        ((double) (cv::getTickCount () - start) * 1000) /
+            cv::getTickFrequency());
 
   /* Get the original coordinates */
-  if (filter->scale_factor != 1.0) {
-    if (debug)
-      start = cv::getTickCount ();
-    for (i = 0; i < dets.size (); i++) {
+  if (job.scale_factor != 1.0) {
+    for (i = 0; i < job.dets.size (); i++) {
       dlib::rectangle new_det (
-          dets[i].left () / filter->scale_factor,
-          dets[i].top () / filter->scale_factor,
-          dets[i].right () / filter->scale_factor,
-          dets[i].bottom () / filter->scale_factor);
-      dets[i] = new_det;
-    }
-    if (debug) {
-      end = cv::getTickCount ();
-      time_scale_up = end - start;
+          job.dets[i].left () / job.scale_factor,
+          job.dets[i].top () / job.scale_factor,
+          job.dets[i].right () / job.scale_factor,
+          job.dets[i].bottom () / job.scale_factor);
+      job.dets[i] = new_det;
     }
   }
+}
 
-  if (!filter->use_hungarian) {
+/* Estimates the pose of a face from its 68-keypoints landmark shape. */
+static void
+gst_cheese_face_detect_estimate_pose (GstCheeseFaceDetect * filter, guint id,
+    CheeseFace & face, dlib::full_object_detection & shape,
+    gdouble scale_factor)
+{
+  static const guint pose_pts[6] = {30, 8, 36, 45, 48, 54};
+  guint i;
+  cv::Mat rotation_vector;
+  cv::Mat translation_vector;
+  cv::Mat rotation_matrix;
+  cv::Mat measured_eulers;
+  /* Fixed sizes, so they live on the stack and are wrapped by cv::Mat. */
+  cv::Point2d image_points[G_N_ELEMENTS (pose_pts)];
+  cv::Point3d nose_end_point3D[] = {
+    cv::Point3d (0, 0, 1000.0),
+    cv::Point3d (0, 1000.0, 0),
+    cv::Point3d (-1000.0, 0, 0)
+  };
+  cv::Point2d nose_end_point2D[G_N_ELEMENTS (nose_end_point3D)];
+  cv::Mat nose_end_point2D_mat (G_N_ELEMENTS (nose_end_point2D), 1, CV_64FC2,
+      nose_end_point2D);
+
+  GST_LOG ("Face %d: calculate pose estimation.", id);
+  for (i = 0; i < G_N_ELEMENTS (pose_pts); i++) {
+    const guint index = pose_pts[i];
+    image_points[i] = cv::Point2d (shape.part (index).x () / scale_factor,
+        shape.part (index).y () / scale_factor);
+  }
+  cv::solvePnP (*filter->pose_model_points,
+      cv::Mat (G_N_ELEMENTS (image_points), 1, CV_64FC2, image_points),
+      *filter->camera_matrix, *filter->dist_coeffs,
+      rotation_vector, translation_vector);
+
+  projectPoints (
+      cv::Mat (G_N_ELEMENTS (nose_end_point3D), 1, CV_64FC3, nose_end_point3D),
+      rotation_vector, translation_vector,
+      *filter->camera_matrix, *filter->dist_coeffs, nose_end_point2D_mat);
+
+  GST_LOG ("Face %d: rotation vector is (%.4f, %.4f, %.4f).", id,
+      rotation_vector.at<double> (0, 0),
+      rotation_vector.at<double> (1, 0),
+      rotation_vector.at<double> (2, 0));
+  /* TODO: Log translation matrix */
+
+  cv::Rodrigues(rotation_vector, rotation_matrix);
+  measured_eulers = rot2euler(rotation_matrix);
+
+  face.pose_axis_origin = image_points[0];
+  for (i = 0; i < G_N_ELEMENTS (face.pose_axis); i++)
+    face.pose_axis[i] = nose_end_point2D[i];
+  face.pose_euler_angles = GRAPHENE_POINT3D_INIT (
+      (float) measured_eulers.at<double> (0),
+      (float) measured_eulers.at<double> (1),
+      (float) measured_eulers.at<double> (2));
+  face.has_pose = TRUE;
+
+  GST_LOG ("Face %d: euler angles are (%.4f, %.4f, %.4f).", id,
+      face.pose_euler_angles.x, face.pose_euler_angles.y,
+      face.pose_euler_angles.z);
+}
+
+/* Detects the landmark of a face and, if enabled, estimates its pose. */
+static void
+gst_cheese_face_detect_estimate_landmark (GstCheeseFaceDetect * filter,
+    const CheeseFaceDetectSettings & settings, cv::Mat & img,
+    gdouble scale_factor, guint id, CheeseFace & face)
+{
+  guint j;
+  dlib::rectangle scaled_det (
+      face.bounding_box.left () * scale_factor,
+      face.bounding_box.top () * scale_factor,
+      face.bounding_box.right () * scale_factor,
+      face.bounding_box.bottom () * scale_factor);
+
+  GST_LOG ("Face %d: detect landmark.", id);
+  dlib::full_object_detection shape =
+      cheese_shape_predict (*settings.shape_predictor, img, scaled_det);
+
+  face.landmark.clear ();
+  for (j = 0; j < shape.num_parts (); j++) {
+    cv::Point pt (shape.part (j).x () / scale_factor,
+        shape.part (j).y () / scale_factor);
+    face.landmark.push_back (pt);
+  }
+
+  face.has_pose = FALSE;
+  if (settings.use_pose_estimation &&
+      shape.num_parts () == MAX_FACIAL_KEYPOINTS)
+    gst_cheese_face_detect_estimate_pose (filter, id, face, shape,
+        scale_factor);
+}
+
+struct CheeseFaceDetectLandmarkBatch {
+  GstCheeseFaceDetect *filter;
+  const CheeseFaceDetectSettings *settings;
+  cv::Mat *img;
+  gdouble scale_factor;
+  CheeseArenaVector<std::pair<guint, CheeseFace *>> faces;
+
+  CheeseFaceDetectLandmarkBatch (CheeseArena * arena) : faces (arena) {}
+};
+
+static void
+gst_cheese_face_detect_landmark_task (guint index, gpointer user_data)
+{
+  CheeseFaceDetectLandmarkBatch *batch =
+      (CheeseFaceDetectLandmarkBatch *) user_data;
+
+  gst_cheese_face_detect_estimate_landmark (batch->filter, *batch->settings,
+      *batch->img,
+      batch->scale_factor, batch->faces[index].first,
+      *batch->faces[index].second);
+}
+
+/* Matches the detections of the job with the known faces and updates the
+ * landmark and the pose of the faces found in this frame. The ids of the
+ * faces that are forgotten are appended to @removed_faces.
+ */
+static void
+gst_cheese_face_detect_update_faces (GstCheeseFaceDetect * filter,
+    CheeseFaceDetectJob & job, GArray * removed_faces)
+{
+  guint i;
+  GstCheeseFaceDetectClass *klass = GST_CHEESEFACEDETECT_GET_CLASS (filter);
+  std::vector<rectangle> & dets = job.dets;
+  const CheeseFaceDetectSettings & settings = job.settings;
+  gboolean debug = gst_debug_is_active ();
+  gint64 start, time_landmark;
+  CheeseFaceDetectLandmarkBatch batch (filter->arena);
+
+  if (!settings.use_hungarian) {
     /* If we are not remapping faces by using the Hungarian Algorithm
      * so reset all the info as defaults. */
     filter->last_face_id = 0;
@@ -547,8 +1001,8 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
     };
   }
 
-  if (filter->use_hungarian) {
-    std::vector<guint> to_remove;
+  if (settings.use_hungarian) {
+    CheeseArenaVector<guint> to_remove (filter->arena);
     for (auto &kv : *filter->faces) {
       guint delta_since_detected;
       guint id = kv.first;
@@ -558,32 +1012,38 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
       GST_LOG ("Face %d: number of frames passed since last detection of "
           "face is delta=%d.", id, delta_since_detected);
 
-      if (delta_since_detected > filter->hungarian_delete_threshold) {
+      if (delta_since_detected > settings.hungarian_delete_threshold) {
         GST_LOG ("Face %d will be deleted: "
             "delta=%d > hungarian-delete-threshold=%d.", id,
-            delta_since_detected, filter->hungarian_delete_threshold);
+            delta_since_detected, settings.hungarian_delete_threshold);
         to_remove.push_back (id);
       }
     }
     for (i = 0; i < to_remove.size (); i++) {
-      GST_LOG ("Face %d was deleted.", i);
+      GST_LOG ("Face %d was deleted.", to_remove[i]);
       filter->faces->erase (to_remove[i]);
-      gst_cheese_multiface_meta_add_removed_face_id (multiface_meta, i);
+      g_array_append_val (removed_faces, to_remove[i]);
     }
   }
 
-  if (!filter->faces->empty() && filter->use_hungarian) {
-    guint r, c;
-    HungarianAlgorithm HungAlgo;
-    std::vector<cv::Point> cur_centroids;
-    std::vector<std::vector<double>> cost_matrix;
-    std::vector<guint> faces_keys;
-    std::vector<CheeseFace *> faces_vals;
-    std::vector<int> assignment;
+  if (!filter->faces->empty() && settings.use_hungarian) {
+    CheeseArenaVector<cv::Point> cur_centroids (filter->arena);
+    CheeseArenaVector<guint> faces_keys (filter->arena);
+    CheeseArenaVector<CheeseFace *> faces_vals (filter->arena);
+    CheeseArenaVector<cv::Point> faces_centroids (filter->arena);
+    CheeseArenaVector<gfloat> faces_radii (filter->arena);
+    CheeseArenaVector<gint> assignment (filter->arena);
+    CheeseArenaVector<gboolean> assigned_dets (filter->arena);
 
     if (debug)
       start = cv::getTickCount ();
 
+    cur_centroids.reserve (dets.size ());
+    faces_keys.reserve (filter->faces->size ());
+    faces_vals.reserve (filter->faces->size ());
+    faces_centroids.reserve (filter->faces->size ());
+    faces_radii.reserve (filter->faces->size ());
+
     // Calculate current centroids.
     for (i = 0; i < dets.size(); i++) {
       cv::Point centroid = calculate_centroid(dets[i]);
@@ -596,26 +1056,22 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
       CheeseFace *face = &kv.second;
       faces_keys.push_back(id);
       faces_vals.push_back(face);
+      faces_centroids.push_back (face->centroid);
+      faces_radii.push_back (
+          settings.distance_factor * face->bounding_box.width ());
     }
 
-    GST_LOG ("Hungarian method: initialize cost matrix of "
+    /* Solve the Hungarian problem, only between neighbours. */
+    GST_LOG ("Hungarian method: solve the Hungarian problem of "
         "previous detected faces x current detected faces: %d(rows) x %d(cols)",
         (gint) faces_vals.size (), (gint) cur_centroids.size ());
-    /* Initialize cost matrix. */
-    for (r = 0; r < faces_vals.size (); r++) {
-      std::vector<double> row;
-      for (c = 0; c < cur_centroids.size (); c++) {
-        float dist;
-        dist = cv::norm (cv::Mat (cur_centroids[c]),
-            cv::Mat (faces_vals[r]->centroid));
-        row.push_back(dist);
-      }
-      cost_matrix.push_back(row);
-    }
-
-    /* Solve the Hungarian problem */
-    GST_LOG ("Hungarian method: solve the Hungarian problem.");
-    HungAlgo.Solve(cost_matrix, assignment);
+    assignment.resize (faces_vals.size ());
+    filter->assignment->solve (faces_centroids.data (), faces_radii.data (),
+        faces_vals.size (), cur_centroids.data (), NULL, cur_centroids.size (),
+        assignment.data ());
+    GST_LOG ("Hungarian method: %u pairs close enough in %u groups.",
+        filter->assignment->n_pairs, filter->assignment->n_components);
+    assigned_dets.assign (dets.size (), FALSE);
 
     /* Reorder faces */
     GST_LOG ("Hungarian method: reorder faces according the solution of the"
@@ -625,9 +1081,16 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
         GST_LOG ("Hungarian method: current detected face at position %d "
             "will be ignored.", i);
       } else {
+        cv::Point centroid = calculate_centroid (dets[assignment[i]]);
+        guint frames =
+            filter->frame_number - faces_vals[i]->last_detected_frame;
+        if (frames > 0)
+          faces_vals[i]->motion =
+              (centroid - faces_vals[i]->centroid) / (gint) frames;
         faces_vals[i]->bounding_box = dets[assignment[i]];
-        faces_vals[i]->centroid = calculate_centroid (dets[assignment[i]]);
+        faces_vals[i]->centroid = centroid;
         faces_vals[i]->last_detected_frame = filter->frame_number;
+        assigned_dets[assignment[i]] = TRUE;
         GST_LOG ("Hungarian method: previous detected face %d mapped to "
             "current detected face at position %d.", i, assignment[i]);
       }
@@ -637,8 +1100,7 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
     GST_LOG ("Create new faces for restant faces not assigned by the "
         "Hungarian method.");
     for (i = 0; i < dets.size (); i++) {
-      if (!(std::find (assignment.begin(), assignment.end (), i) !=
-          assignment.end ())) {
+      if (!assigned_dets[i]) {
         /**
          * FIXME
          * When we declare a new CheeseFace in this way we actually create a
@@ -649,21 +1111,21 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
         face_info.last_detected_frame = filter->frame_number;
         face_info.bounding_box = dets[i];
         face_info.centroid = calculate_centroid(dets[i]);
-        (*filter->faces)[++filter->last_face_id] = face_info;
         face_info.free_user_data_func = klass->cheese_face_free_user_data_func;
+        (*filter->faces)[++filter->last_face_id] = face_info;
         GST_LOG ("Face %d has been created.", filter->last_face_id);
       }
     }
-    if (debug) {
-      end = cv::getTickCount ();
-      time_hungarian = end - start;
-    }
+    if (debug)
+      GST_DEBUG ("Time to solve hungarian problem: %.2f ms.",
+          ((double) (cv::getTickCount () - start) * 1000) /
+              cv::getTickFrequency());
   }
 
   /* Initialize camera matrix */
   if (!filter->camera_matrix) {
-    cv::Point2d center (cvImg.cols / 2, cvImg.rows / 2);
-    double focal_length = cvImg.cols;
+    cv::Point2d center (job.frame.cols / 2, job.frame.rows / 2);
+    double focal_length = job.frame.cols;
     filter->camera_matrix = new cv::Mat;
     filter->dist_coeffs = new cv::Mat;
     *filter->camera_matrix =
@@ -673,318 +1135,695 @@ gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
     *filter->dist_coeffs = cv::Mat::zeros(4, 1, cv::DataType<double>::type);
   }
 
-  if (debug) {
-    time_pose_estimation = 0;
-    time_landmark = 0;
+  if (settings.full_scan_interval > 0)
+    gst_cheese_face_detect_update_roi_windows (filter);
+
+  /* Only the faces found in this frame get a new landmark. Each face is
+   * handled by its own task, so the results do not depend on the order the
+   * tasks are run in. */
+  if (settings.shape_predictor) {
+    if (debug)
+      start = cv::getTickCount ();
+    batch.filter = filter;
+    batch.settings = &settings;
+    batch.img = &job.resized_frame;
+    batch.scale_factor = job.scale_factor;
+    for (auto &kv : *filter->faces) {
+      if (kv.second.last_detected_frame == filter->frame_number)
+        batch.faces.push_back (std::make_pair (kv.first, &kv.second));
+    }
+    cheese_worker_pool_run (batch.faces.size (), 0,
+        gst_cheese_face_detect_landmark_task, &batch);
+    if (debug) {
+      time_landmark = cv::getTickCount () - start;
+      GST_DEBUG ("Time to calculate landmark and pose: %.2f ms.",
+          ((double) time_landmark * 1000) / cv::getTickFrequency());
+    }
   }
 
+  /* Nothing allocated from the arena outlives the frame. */
+  filter->arena->reset ();
+}
+
+/* Draws the faces found in the frame of the job. */
+static void
+gst_cheese_face_detect_draw_faces (GstCheeseFaceDetect * filter,
+    CheeseFaceDetectJob & job)
+{
+  guint j;
+  cv::Mat & img = job.frame;
+  const CheeseFaceDetectSettings & settings = job.settings;
+  const cv::Scalar red = cheese_video_frame_color (cv::Scalar (255, 0, 0), img);
+  const cv::Scalar green =
+      cheese_video_frame_color (cv::Scalar (0, 255, 0), img);
+  const cv::Scalar blue =
+      cheese_video_frame_color (cv::Scalar (0, 0, 255), img);
+
   for (auto &kv : *filter->faces) {
-    GValue facedata_value = G_VALUE_INIT;
-    GstStructure *facedata_st;
-    GstCheeseFaceInfo *info;
     guint id = kv.first;
     CheeseFace &face = kv.second;
 
-    cv::Mat rotation_vector;
-    cv::Mat translation_vector;
-    std::vector<cv::Point2d> image_points;
-    guint pose_pts[6] = {30, 8, 36, 45, 48, 54};
+    if (face.last_detected_frame != filter->frame_number)
+      continue;
 
-    if (post_msg && face.last_detected_frame == filter->frame_number) {
-      if (debug)
-        start = cv::getTickCount ();
-      facedata_st = gst_structure_new_empty ("face");
-      g_value_init (&facedata_value, GST_TYPE_STRUCTURE);
-      if (debug) {
-        end = cv::getTickCount ();
-        time_post += end - start;
+    /* Draw bounding box of the face */
+    if (settings.display_bounding_box) {
+      cv::Point tl, br;
+      tl = cv::Point(face.bounding_box.left(), face.bounding_box.top());
+      br = cv::Point(face.bounding_box.right(), face.bounding_box.bottom());
+      cv::rectangle (img, tl, br, green);
+      GST_LOG ("Face %d: drawing bounding.", id);
+    }
+
+    /* Draw ID assigned to the face */
+    if (settings.display_id) {
+      cv::putText (img, std::to_string (id), face.centroid,
+          cv::FONT_HERSHEY_SIMPLEX, 1.0, red);
+      GST_LOG ("Face %d: drawing id.", id);
+    }
+
+    if (!settings.shape_predictor)
+      continue;
+
+    if (settings.display_pose_estimation && face.has_pose) {
+      cv::line(img, face.pose_axis_origin, face.pose_axis[0], red, 2);
+      cv::line(img, face.pose_axis_origin, face.pose_axis[1], green, 2);
+      cv::line(img, face.pose_axis_origin, face.pose_axis[2], blue, 2);
+      GST_LOG ("Face %d: drawing pose estimation axis.", id);
+    }
+
+    if (settings.display_landmark) {
+      for (j = 0; j < face.landmark.size (); j++)
+        cv::circle(img, face.landmark[j], 2, blue, CV_FILLED);
+    }
+  }
+}
+
+/* Draws the faces of a result computed by the background thread. Only the
+ * information carried by the metadata is available here, so the pose axis is
+ * not drawn in async mode. */
+static void
+gst_cheese_face_detect_draw_faces_info (GstCheeseFaceDetect * filter,
+    cv::Mat & img, GstCheeseMultifaceInfo * faces_info)
+{
+  GstCheeseMultifaceInfoIter iter;
+  GstCheeseFaceInfo *info;
+  guint id, j;
+  const cv::Scalar red = cheese_video_frame_color (cv::Scalar (255, 0, 0), img);
+  const cv::Scalar green =
+      cheese_video_frame_color (cv::Scalar (0, 255, 0), img);
+  const cv::Scalar blue =
+      cheese_video_frame_color (cv::Scalar (0, 0, 255), img);
+
+  gst_cheese_multiface_info_iter_init (&iter, faces_info);
+  while (gst_cheese_multiface_info_iter_next (&iter, &id, &info)) {
+    graphene_rect_t rect;
+    GArray *keypoints;
+    cv::Point tl, br;
+
+    if (!cheese_face_info_get_display (info))
+      continue;
+
+    rect = cheese_face_info_get_bounding_box (info);
+    tl = cv::Point (rect.origin.x, rect.origin.y);
+    br = cv::Point (rect.origin.x + rect.size.width,
+        rect.origin.y + rect.size.height);
+    if (filter->display_bounding_box)
+      cv::rectangle (img, tl, br, green);
+    if (filter->display_id)
+      cv::putText (img, std::to_string (id), (tl + br) / 2,
+          cv::FONT_HERSHEY_SIMPLEX, 1.0, red);
+    if (filter->display_landmark) {
+      keypoints = cheese_face_info_get_landmark_keypoints (info);
+      for (j = 0; j < keypoints->len; j++) {
+        graphene_point_t *pt =
+            &g_array_index (keypoints, graphene_point_t, j);
+        cv::circle(img, cv::Point (pt->x, pt->y), 2, blue,
+            CV_FILLED);
       }
     }
+  }
+}
+
+/* Posts the faces found in the frame of the job to the bus and stores all
+ * the known faces in @faces_info. */
+static void
+gst_cheese_face_detect_publish_faces (GstCheeseFaceDetect * filter,
+    CheeseFaceDetectJob & job, GstCheeseMultifaceInfo * faces_info)
+{
+  guint j;
+  GstMessage *msg;
+  GValue faces_values = G_VALUE_INIT;
+  const gint n_keypoints =
+      CHEESE_FACE_LANDMARK_N (CHEESE_FACE_LANDMARK_TYPE_68);
 
-    /* Post the bounding box info of the face */
-    if (post_msg && face.last_detected_frame == filter->frame_number) {
-      if (debug)
-        start = cv::getTickCount ();
+  msg = gst_cheese_face_detect_message_new (filter, job);
+  g_value_init (&faces_values, GST_TYPE_LIST);
+
+  for (auto &kv : *filter->faces) {
+    guint id = kv.first;
+    CheeseFace &face = kv.second;
+    const gboolean detected = face.last_detected_frame == filter->frame_number;
+    GstCheeseFaceInfo *info;
+
+    if (detected) {
+      GValue facedata_value = G_VALUE_INIT;
       GValue box_value = G_VALUE_INIT;
+      GValue id_value = G_VALUE_INIT;
+      GstStructure *facedata_st;
       graphene_rect_t graphene_bounding_box;
 
-      g_value_init (&box_value, GRAPHENE_TYPE_RECT);
+      facedata_st = gst_structure_new_empty ("face");
+      g_value_init (&facedata_value, GST_TYPE_STRUCTURE);
 
+      /* Post the bounding box info of the face */
+      g_value_init (&box_value, GRAPHENE_TYPE_RECT);
       graphene_bounding_box = GRAPHENE_RECT_INIT (face.bounding_box.left (),
           face.bounding_box.top (), face.bounding_box.width (),
           face.bounding_box.height ());
       g_value_set_boxed (&box_value, &graphene_bounding_box);
       gst_structure_set_value (facedata_st, "bounding-box", &box_value);
-      if (debug) {
-        end = cv::getTickCount ();
-        time_post += end - start;
-      }
+      g_value_unset (&box_value);
       GST_LOG ("Face %d: add bounding box information to the message.", id);
-    }
-    /* Draw bounding box of the face */
-    if (filter->display_bounding_box &&
-        face.last_detected_frame == filter->frame_number) {
-      cv::Point tl, br;
-      tl = cv::Point(face.bounding_box.left(), face.bounding_box.top());
-      br = cv::Point(face.bounding_box.right(), face.bounding_box.bottom());
-      cv::rectangle (cvImg, tl, br, cv::Scalar (0, 255, 0));
-      GST_LOG ("Face %d: drawing bounding.", id);
-    }
 
-    /* Post the ID assigned to the face */
-    if (post_msg && face.last_detected_frame == filter->frame_number) {
-      GValue id_value = G_VALUE_INIT;
+      /* Post the ID assigned to the face */
       g_value_init (&id_value, G_TYPE_UINT);
       g_value_set_uint (&id_value, id);
       gst_structure_set_value (facedata_st, "id", &id_value);
       GST_LOG ("Face %d: add id information to the message.", id);
-    }
-    /* Draw ID assigned to the face */
-    if (filter->display_id &&
-        face.last_detected_frame == filter->frame_number) {
-      cv::putText (cvImg, std::to_string (id), face.centroid,
-          cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar (255, 0, 0));
-      GST_LOG ("Face %d: drawing id.", id);
-    }
 
-    if (filter->shape_predictor) {
-      dlib::rectangle scaled_det (
-          face.bounding_box.left () * filter->scale_factor,
-          face.bounding_box.top () * filter->scale_factor,
-          face.bounding_box.right () * filter->scale_factor,
-          face.bounding_box.bottom () * filter->scale_factor);
-
-      GST_LOG ("Face %d: detect landmark.", id);
-      if (debug)
-        start = cv::getTickCount ();
-      dlib::full_object_detection shape =
-          (*filter->shape_predictor) (dlib_img, scaled_det);
-      if (debug) {
-        end = cv::getTickCount ();
-        time_landmark += end - start;
+      if (face.has_pose) {
+        GValue rotation_value = G_VALUE_INIT;
+        g_value_init (&rotation_value, GRAPHENE_TYPE_POINT3D);
+        g_value_set_boxed (&rotation_value, &face.pose_euler_angles);
+        gst_structure_set_value (facedata_st, "pose-rotation-vector",
+            &rotation_value);
+        g_value_unset (&rotation_value);
+        GST_LOG ("Face %d: add pose euler angles to the message.", id);
       }
 
-      /* Draw the landmark of the face or/and post it as a message */
-      if ((filter->display_landmark || post_msg) &&
-          face.last_detected_frame == filter->frame_number) {
+      if (job.settings.shape_predictor) {
         GValue landmark_values = G_VALUE_INIT;
-
-        if (post_msg)
-          g_value_init (&landmark_values, GST_TYPE_ARRAY);
-
-        /* Pose estimation */
-        if (filter->use_pose_estimation) {
-          cv::Mat rotation_matrix;
-          GST_LOG ("Face %d: calculate pose estimation.", id);
-          for (i = 0; i < 6; i++) {
-            const guint index = pose_pts[i];
-            cv::Point2d pt (shape.part (index).x () / filter->scale_factor,
-                            shape.part (index).y () / filter->scale_factor);
-            image_points.push_back(pt);
-          }
-          if (debug)
-            start = cv::getTickCount ();
-          cv::solvePnP (*filter->pose_model_points, image_points,
-              *filter->camera_matrix, *filter->dist_coeffs,
-              rotation_vector, translation_vector);
-          if (debug) {
-            end = cv::getTickCount ();
-            time_pose_estimation += end - start;
-          }
-
-          std::vector<cv::Point3d> nose_end_point3D;
-          std::vector<cv::Point2d> nose_end_point2D;
-          nose_end_point3D.push_back(cv::Point3d (0, 0, 1000.0));
-          nose_end_point3D.push_back(cv::Point3d (0, 1000.0, 0));
-          nose_end_point3D.push_back(cv::Point3d (-1000.0, 0, 0));
-
-          projectPoints(nose_end_point3D, rotation_vector, translation_vector,
-              *filter->camera_matrix, *filter->dist_coeffs, nose_end_point2D);
-
-          GST_LOG ("Face %d: rotation vector is (%.4f, %.4f, %.4f).", id,
-              rotation_vector.at<double> (0, 0),
-              rotation_vector.at<double> (1, 0),
-              rotation_vector.at<double> (2, 0));
-          /* TODO: Log translation matrix */
-
-          if (filter->display_pose_estimation) {
-            cv::line(cvImg, image_points[0], nose_end_point2D[0],
-                cv::Scalar(255, 0, 0), 2);
-            cv::line(cvImg, image_points[0], nose_end_point2D[1],
-                cv::Scalar(0, 255, 0), 2);
-            cv::line(cvImg, image_points[0], nose_end_point2D[2],
-                cv::Scalar(0, 0, 255), 2);
-            GST_LOG ("Face %d: drawing pose estimation axis.", id);
-          }
-
-          if (post_msg) {
-            cv::Vec3d axis {0, 0, -1};
-            graphene_point3d_t rotation_graphene_vector;
-            GValue rotation_value = G_VALUE_INIT;
-            double dir_x, dir_y, dir_z, len;
-            cv::Mat direction_matrix;
-            if (debug)
-              start = cv::getTickCount ();
-            g_value_init (&rotation_value, GRAPHENE_TYPE_POINT3D);
-
-            cv::Rodrigues(rotation_vector, rotation_matrix);
-            cv::Mat measured_eulers(3, 1, CV_64F);
-            measured_eulers = rot2euler(rotation_matrix);
-
-            rotation_graphene_vector = GRAPHENE_POINT3D_INIT (
-                (float) measured_eulers.at<double> (0),
-                (float) measured_eulers.at<double> (1),
-                (float) measured_eulers.at<double> (2));
-
-            /* TODO */
-            /* LOG Rotation matrix */
-            GST_LOG ("Face %d: euler angles are (%.4f, %.4f, %.4f).", id,
-                rotation_graphene_vector.x, rotation_graphene_vector.y,
-                rotation_graphene_vector.z);
-            g_value_set_boxed (&rotation_value, &rotation_graphene_vector);
-            gst_structure_set_value (facedata_st, "pose-rotation-vector",
-                &rotation_value);
-            if (debug) {
-              end = cv::getTickCount ();
-              time_post += end - start;
-            }
-            GST_LOG ("Face %d: add pose euler angles to the message.", id);
-          }
-        }
-        /* end */
-        face.landmark.clear ();
-        for (j = 0; j < shape.num_parts (); j++) {
-          cv::Point pt (shape.part (j).x () / filter->scale_factor,
-              shape.part (j).y () / filter->scale_factor);
-          face.landmark.push_back (pt);
-          if (filter->display_landmark) {
-            cv::circle(cvImg, pt, 2, cv::Scalar (0, 0, 255), CV_FILLED);
-          }
-          if (post_msg) {
-            GValue point_value = G_VALUE_INIT;
-            graphene_point_t graphene_point =
-                GRAPHENE_POINT_INIT (shape.part (j).x () / filter->scale_factor,
-                    shape.part (j).y () / filter->scale_factor);
-            if (debug)
-              start = cv::getTickCount ();
-            g_value_init (&point_value, GRAPHENE_TYPE_POINT);
-            g_value_set_boxed (&point_value, &graphene_point);
-            gst_value_array_append_value (&landmark_values, &point_value);
-            if (debug) {
-              end = cv::getTickCount ();
-              time_post += end - start;
-            }
-          }
-        }
-
-        if (post_msg && face.last_detected_frame == filter->frame_number) {
-          if (debug)
-            start = cv::getTickCount ();
-          gst_structure_set_value (facedata_st, "landmark", &landmark_values);
-          if (debug) {
-            end = cv::getTickCount ();
-            time_post += end - start;
-          }
-          GST_LOG ("Face %d: add landmark information to the message.", id);
+        g_value_init (&landmark_values, GST_TYPE_ARRAY);
+        for (j = 0; j < face.landmark.size (); j++) {
+          GValue point_value = G_VALUE_INIT;
+          graphene_point_t graphene_point =
+              GRAPHENE_POINT_INIT (face.landmark[j].x, face.landmark[j].y);
+          g_value_init (&point_value, GRAPHENE_TYPE_POINT);
+          g_value_set_boxed (&point_value, &graphene_point);
+          gst_value_array_append_value (&landmark_values, &point_value);
+          g_value_unset (&point_value);
         }
+        gst_structure_set_value (facedata_st, "landmark", &landmark_values);
+        g_value_unset (&landmark_values);
+        GST_LOG ("Face %d: add landmark information to the message.", id);
       }
-    }
-    if (post_msg && face.last_detected_frame == filter->frame_number) {
-      if (debug)
-        start = cv::getTickCount ();
+
       g_value_take_boxed (&facedata_value, facedata_st);
       gst_value_list_append_value (&faces_values, &facedata_value);
       g_value_unset (&facedata_value);
-      if (debug) {
-        end = cv::getTickCount ();
-        time_post += end - start;
-      }
       GST_LOG ("Faces: append message with information about face %d.", id);
     }
 
-    if (post_msg) {
-      int n_keypoints = CHEESE_FACE_LANDMARK_N (CHEESE_FACE_LANDMARK_TYPE_68);
-      /* Set metadata */
-      info = gst_cheese_face_info_new ();
-      gst_cheese_multiface_info_insert (multiface_meta->faces, id, info);
-      /* Add metadata info */
-      cheese_face_info_set_bounding_box (info,
-          GRAPHENE_RECT_INIT (face.bounding_box.left (),
-              face.bounding_box.top (), face.bounding_box.width (),
-              face.bounding_box.height ()));
-      cheese_face_info_set_display (info,
-          face.last_detected_frame == filter->frame_number);
-
-      if (face.landmark.size () == n_keypoints) {
-        guint it;
-        graphene_point_t landmark_keypoints[n_keypoints];
-        for (it = 0; it < face.landmark.size (); it++)
-          landmark_keypoints[it] =
-              GRAPHENE_POINT_INIT (face.landmark[it].x, face.landmark[it].y);
-        cheese_face_info_set_landmark_keypoints (info, landmark_keypoints,
-            n_keypoints);
-      }
+    /* Set metadata */
+    info = gst_cheese_face_info_new ();
+    gst_cheese_multiface_info_insert (faces_info, id, info);
+    /* Add metadata info */
+    cheese_face_info_set_bounding_box (info,
+        GRAPHENE_RECT_INIT (face.bounding_box.left (),
+            face.bounding_box.top (), face.bounding_box.width (),
+            face.bounding_box.height ()));
+    cheese_face_info_set_display (info, detected);
+
+    if (face.landmark.size () == n_keypoints) {
+      guint it;
+      graphene_point_t landmark_keypoints[n_keypoints];
+      for (it = 0; it < face.landmark.size (); it++)
+        landmark_keypoints[it] =
+            GRAPHENE_POINT_INIT (face.landmark[it].x, face.landmark[it].y);
+      cheese_face_info_set_landmark_keypoints (info, landmark_keypoints,
+          n_keypoints);
     }
   }
-  cvImg.release ();
-  /* end = chrono::steady_clock::now(); */
 
-  if (post_msg) {
-    if (debug)
-      start = cv::getTickCount ();
-    gst_structure_set_value ((GstStructure *) gst_message_get_structure (msg),
-        "faces", &faces_values);
-    g_value_unset (&faces_values);
-    gst_element_post_message (GST_ELEMENT (filter), msg);
-    if (debug) {
-      end = cv::getTickCount ();
-      time_post += end - start;
-    }
-    GST_LOG ("Faces: post the message to the bus.");
+  gst_structure_set_value ((GstStructure *) gst_message_get_structure (msg),
+      "faces", &faces_values);
+  g_value_unset (&faces_values);
+  gst_element_post_message (GST_ELEMENT (filter), msg);
+  GST_LOG ("Faces: post the message to the bus.");
+}
+
+static gpointer
+gst_cheese_face_detect_async_loop (gpointer user_data)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (user_data);
+
+  g_mutex_lock (&filter->async_lock);
+  while (TRUE) {
+    CheeseFaceDetectJob *job;
+    GstCheeseMultifaceInfo *faces_info;
+    GArray *removed_faces;
+
+    while (!filter->async_stop && !filter->async_job)
+      g_cond_wait (&filter->async_cond, &filter->async_lock);
+    if (filter->async_stop)
+      break;
+    /* The job stays set while it is processed so no other frame is handed
+     * to this thread in the meantime. */
+    job = filter->async_job;
+    g_mutex_unlock (&filter->async_lock);
+
+    faces_info = gst_cheese_multiface_info_new ();
+    removed_faces = g_array_new (FALSE, FALSE, sizeof (guint));
+    gst_cheese_face_detect_detect_faces (filter, *job);
+    gst_cheese_face_detect_update_faces (filter, *job, removed_faces);
+    gst_cheese_face_detect_publish_faces (filter, *job, faces_info);
+    filter->frame_number++;
+
+    g_mutex_lock (&filter->async_lock);
+    if (filter->async_result)
+      gst_mini_object_unref (GST_MINI_OBJECT_CAST (filter->async_result));
+    filter->async_result = faces_info;
+    filter->async_result_pts = job->pts;
+    g_array_append_vals (filter->async_removed_faces, removed_faces->data,
+        removed_faces->len);
+    filter->async_job = NULL;
+    g_array_unref (removed_faces);
+    delete job;
+    GST_LOG ("Background detection finished.");
+  }
+  g_mutex_unlock (&filter->async_lock);
+
+  return NULL;
+}
+
+static void
+gst_cheese_face_detect_async_stop (GstCheeseFaceDetect * filter)
+{
+  g_mutex_lock (&filter->async_lock);
+  if (filter->async_thread) {
+    GThread *thread = filter->async_thread;
+
+    filter->async_stop = TRUE;
+    g_cond_signal (&filter->async_cond);
+    g_mutex_unlock (&filter->async_lock);
+    g_thread_join (thread);
+    g_mutex_lock (&filter->async_lock);
+    filter->async_thread = NULL;
+    filter->async_stop = FALSE;
+  }
+  if (filter->async_job) {
+    delete filter->async_job;
+    filter->async_job = NULL;
+  }
+  if (filter->async_result) {
+    gst_mini_object_unref (GST_MINI_OBJECT_CAST (filter->async_result));
+    filter->async_result = NULL;
+  }
+  g_array_set_size (filter->async_removed_faces, 0);
+  filter->async_result_pts = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (&filter->async_lock);
+}
+
+/* Hands the frame to the background thread if it is idle and attaches the
+ * most recent result to the buffer. */
+static GstFlowReturn
+gst_cheese_face_detect_transform_ip_async (GstCheeseFaceDetect * filter,
+    GstBuffer * buf, cv::Mat & img, GstCheeseMultifaceMeta * multiface_meta)
+{
+  g_mutex_lock (&filter->async_lock);
+  if (!filter->async_thread)
+    filter->async_thread = g_thread_new ("cheesefacedetect",
+        gst_cheese_face_detect_async_loop, filter);
+
+  if (!filter->async_job) {
+    CheeseFaceDetectJob *job = new CheeseFaceDetectJob;
+    gst_cheese_face_detect_job_init (filter, *job, buf, img);
+    job->frame = img.clone ();
+    filter->async_job = job;
+    g_cond_signal (&filter->async_cond);
+    GST_LOG ("Frame handed to the background thread.");
+  }
+
+  if (filter->async_result) {
+    gst_mini_object_unref (GST_MINI_OBJECT_CAST (multiface_meta->faces));
+    multiface_meta->faces =
+        gst_cheese_multiface_info_copy (filter->async_result);
+    multiface_meta->pts = filter->async_result_pts;
   }
+  g_array_append_vals (multiface_meta->removed_faces,
+      filter->async_removed_faces->data, filter->async_removed_faces->len);
+  g_array_set_size (filter->async_removed_faces, 0);
+  g_mutex_unlock (&filter->async_lock);
+
+  gst_cheese_face_detect_draw_faces_info (filter, img, multiface_meta->faces);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_cheese_face_detect_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (vfilter);
+
+  return cheese_video_frame_set_info (vfilter, in_info, filter->scratch_pool);
+}
+
+static GstFlowReturn
+gst_cheese_face_detect_transform_frame_ip (GstVideoFilter * vfilter,
+    GstVideoFrame * frame)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (vfilter);
+
+  return cheese_video_frame_transform_frame_ip (vfilter, frame,
+      filter->scratch_pool);
+}
+
+/* chain function
+ * this function does the actual processing
+ *
+ * In pipelined mode it is called by the update stage, the faces of the frame
+ * have already been detected in filter->pipeline_job.
+ */
+static GstFlowReturn
+gst_cheese_face_detect_transform_ip (GstOpencvVideoFilter * base,
+    GstBuffer * buf, cv::Mat cvImg)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (base);
+  GstCheeseMultifaceMeta *multiface_meta;
+  CheeseFaceDetectJob sync_job;
+  CheeseFaceDetectJob *job = filter->pipeline_job;
+  gboolean debug = gst_debug_is_active ();
+  gint64 time_total;
+
+  multiface_meta = gst_buffer_add_cheese_multiface_meta (buf);
+
   if (debug)
-    time_total = cv::getTickCount () - time_total;
+    time_total = cv::getTickCount ();
 
-  /* I was using this to check what may origin bottlenecks, but maybe there */
-  /* are better tools for this like profiling tools, for example: perf. */
-  if (time_scale_down != -1)
-    GST_DEBUG ("Time to scale down frame: %.2f ms.",
-        ((double) time_scale_down * 1000) / cv::getTickFrequency());
-  if (time_hungarian != -1)
-    GST_DEBUG ("Time to solve hungarian problem: %.2f ms.",
-        ((double) time_hungarian * 1000) / cv::getTickFrequency());
-  if (time_face_detection != -1)
-    GST_DEBUG ("Time to detect a face: %.2f ms.",
-        ((double) time_face_detection * 1000) / cv::getTickFrequency());
-  if (time_scale_up != -1)
-    GST_DEBUG ("Time to scale up frame: %.2f ms.",
-        ((double) time_scale_up * 1000) / cv::getTickFrequency());
-  if (time_pose_estimation != -1)
-    GST_DEBUG ("Time to estimate the pose: %.2f ms.",
-        ((double) time_pose_estimation * 1000) / cv::getTickFrequency());
-  if (time_landmark != -1)
-    GST_DEBUG ("Time to calculate landmark: %.2f ms.",
-        ((double) time_landmark * 1000) / cv::getTickFrequency());
-  if (time_post != -1)
-    GST_DEBUG ("Time post: %.2f ms.",
-        ((double) time_post * 1000) / cv::getTickFrequency ());
-  if (time_total != -1)
+  if (!job) {
+    if (filter->async)
+      return gst_cheese_face_detect_transform_ip_async (filter, buf, cvImg,
+          multiface_meta);
+    /* The background thread owns the faces while it runs. */
+    gst_cheese_face_detect_async_stop (filter);
+
+    job = &sync_job;
+    gst_cheese_face_detect_job_init (filter, *job, buf, cvImg);
+    gst_cheese_face_detect_detect_faces (filter, *job);
+  }
+
+  gst_cheese_face_detect_update_faces (filter, *job,
+      multiface_meta->removed_faces);
+  gst_cheese_face_detect_draw_faces (filter, *job);
+  gst_cheese_face_detect_publish_faces (filter, *job, multiface_meta->faces);
+  multiface_meta->pts = job->pts;
+
+  if (debug) {
+    time_total = cv::getTickCount () - time_total;
     GST_DEBUG ("Time total: %.2f ms.",
         ((double) time_total * 1000) / cv::getTickFrequency ());
+  }
   filter->frame_number++;
 
   return GST_FLOW_OK;
 }
 
+/* Pipelined mode: the first stage detects the faces of a frame while the
+ * second one matches, landmarks and draws the previous one. Each stage runs
+ * on a single thread, so frames go through them in order. */
+static void
+gst_cheese_face_detect_pipeline_detect (gpointer data, gpointer user_data)
+{
+  CheeseFaceDetectJob *job = (CheeseFaceDetectJob *) data;
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (user_data);
+
+  gst_cheese_face_detect_detect_faces (filter, *job);
+  g_thread_pool_push (filter->pipeline_update_pool, job, NULL);
+}
+
+/* Finishes the frame through the cv_trans_ip_func of the class, as the
+ * other modes do, so subclasses still draw their effect on it. */
+static void
+gst_cheese_face_detect_pipeline_update (gpointer data, gpointer user_data)
+{
+  CheeseFaceDetectJob *job = (CheeseFaceDetectJob *) data;
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (user_data);
+  GstOpencvVideoFilterClass *klass = GST_OPENCV_VIDEO_FILTER_GET_CLASS (filter);
+
+  filter->pipeline_job = job;
+  job->ret = klass->cv_trans_ip_func (GST_OPENCV_VIDEO_FILTER_CAST (filter),
+      job->buffer, job->frame);
+  filter->pipeline_job = NULL;
+
+  g_mutex_lock (&filter->pipeline_lock);
+  job->done = TRUE;
+  g_cond_broadcast (&filter->pipeline_cond);
+  g_mutex_unlock (&filter->pipeline_lock);
+}
+
+/* Waits for the oldest job in the pipeline and gives back its buffer in
+ * @buf, or NULL if the job failed, and what the job returned. */
+static GstFlowReturn
+gst_cheese_face_detect_pipeline_pop (GstCheeseFaceDetect * filter,
+    GstBuffer ** buf)
+{
+  CheeseFaceDetectJob *job;
+  GstFlowReturn ret;
+
+  g_mutex_lock (&filter->pipeline_lock);
+  job = (CheeseFaceDetectJob *) g_queue_pop_head (filter->pipeline_jobs);
+  while (!job->done)
+    g_cond_wait (&filter->pipeline_cond, &filter->pipeline_lock);
+  g_mutex_unlock (&filter->pipeline_lock);
+
+  cheese_video_frame_put_cv_mat (&job->video_frame, job->frame);
+  gst_video_frame_unmap (&job->video_frame);
+  ret = job->ret;
+  *buf = job->buffer;
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (*buf);
+    *buf = NULL;
+  }
+  delete job;
+
+  return ret;
+}
+
+/* Empties the pipeline, pushing the held back buffers downstream if @push is
+ * TRUE or dropping them otherwise. */
+static GstFlowReturn
+gst_cheese_face_detect_pipeline_drain (GstCheeseFaceDetect * filter,
+    gboolean push)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (!g_queue_is_empty (filter->pipeline_jobs)) {
+    GstBuffer *buf;
+    GstFlowReturn job_ret = gst_cheese_face_detect_pipeline_pop (filter, &buf);
+
+    if (ret == GST_FLOW_OK)
+      ret = job_ret;
+    if (!buf)
+      continue;
+    if (push && ret == GST_FLOW_OK)
+      ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (filter), buf);
+    else
+      gst_buffer_unref (buf);
+  }
+
+  return ret;
+}
+
+static void
+gst_cheese_face_detect_pipeline_stop (GstCheeseFaceDetect * filter)
+{
+  gst_cheese_face_detect_pipeline_drain (filter, FALSE);
+
+  if (filter->pipeline_detect_pool) {
+    g_thread_pool_free (filter->pipeline_detect_pool, FALSE, TRUE);
+    filter->pipeline_detect_pool = NULL;
+  }
+  if (filter->pipeline_update_pool) {
+    g_thread_pool_free (filter->pipeline_update_pool, FALSE, TRUE);
+    filter->pipeline_update_pool = NULL;
+  }
+}
+
+static GstFlowReturn
+gst_cheese_face_detect_submit_input_buffer (GstBaseTransform * trans,
+    gboolean is_discont, GstBuffer * input)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (trans);
+  GstBaseTransformClass *bclass =
+      GST_BASE_TRANSFORM_CLASS (gst_cheese_face_detect_parent_class);
+  CheeseFaceDetectJob *job;
+  GstFlowReturn ret;
+  cv::Mat img;
+
+  /* The base class does the QoS and keeps the buffer for generate_output,
+   * unless it is too late and dropped. */
+  ret = bclass->submit_input_buffer (trans, is_discont, input);
+  if (filter->pipeline_depth == 0 || ret != GST_FLOW_OK ||
+      !trans->queued_buf)
+    return ret;
+  input = trans->queued_buf;
+  trans->queued_buf = NULL;
+
+  /* The background thread owns the faces while it runs. */
+  gst_cheese_face_detect_async_stop (filter);
+
+  if (!filter->pipeline_detect_pool) {
+    filter->pipeline_detect_pool = g_thread_pool_new (
+        gst_cheese_face_detect_pipeline_detect, filter, 1, FALSE, NULL);
+    filter->pipeline_update_pool = g_thread_pool_new (
+        gst_cheese_face_detect_pipeline_update, filter, 1, FALSE, NULL);
+  }
+
+  job = new CheeseFaceDetectJob;
+  job->buffer = gst_buffer_make_writable (input);
+  job->done = FALSE;
+  if (!gst_video_frame_map (&job->video_frame,
+      &GST_VIDEO_FILTER (filter)->in_info, job->buffer, GST_MAP_READWRITE)) {
+    GST_ELEMENT_ERROR (filter, STREAM, FAILED, (NULL),
+        ("Failed to map the frame."));
+    gst_buffer_unref (job->buffer);
+    delete job;
+    return GST_FLOW_ERROR;
+  }
+  cheese_video_frame_get_cv_mat (&job->video_frame, img, job->scratch);
+  gst_cheese_face_detect_job_init (filter, *job, job->buffer, img);
+
+  g_mutex_lock (&filter->pipeline_lock);
+  g_queue_push_tail (filter->pipeline_jobs, job);
+  g_mutex_unlock (&filter->pipeline_lock);
+  g_thread_pool_push (filter->pipeline_detect_pool, job, NULL);
+  GST_LOG ("Frame submitted to the pipeline, %d frames held back.",
+      g_queue_get_length (filter->pipeline_jobs));
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_cheese_face_detect_generate_output (GstBaseTransform * trans,
+    GstBuffer ** outbuf)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (trans);
+  GstBaseTransformClass *bclass =
+      GST_BASE_TRANSFORM_CLASS (gst_cheese_face_detect_parent_class);
+  guint n_jobs;
+
+  /* Buffers held back by the pipeline always go first, also if the
+   * pipelined mode has just been disabled. */
+  n_jobs = g_queue_get_length (filter->pipeline_jobs);
+  if (n_jobs > 0 && n_jobs > filter->pipeline_depth)
+    return gst_cheese_face_detect_pipeline_pop (filter, outbuf);
+
+  return bclass->generate_output (trans, outbuf);
+}
+
+static gboolean
+gst_cheese_face_detect_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (trans);
+  GstBaseTransformClass *bclass =
+      GST_BASE_TRANSFORM_CLASS (gst_cheese_face_detect_parent_class);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+    case GST_EVENT_CAPS:
+      gst_cheese_face_detect_pipeline_drain (filter, TRUE);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_cheese_face_detect_pipeline_drain (filter, FALSE);
+      break;
+    default:
+      break;
+  }
+
+  return bclass->sink_event (trans, event);
+}
+
+static gboolean
+gst_cheese_face_detect_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (trans);
+  GstBaseTransformClass *bclass =
+      GST_BASE_TRANSFORM_CLASS (gst_cheese_face_detect_parent_class);
+  gboolean ret;
+
+  ret = bclass->query (trans, direction, query);
+
+  if (ret && direction == GST_PAD_SRC &&
+      GST_QUERY_TYPE (query) == GST_QUERY_LATENCY &&
+      filter->pipeline_depth > 0) {
+    GstVideoInfo *info = &GST_VIDEO_FILTER (filter)->in_info;
+    GstClockTime min, max, latency = 0;
+    gboolean live;
+
+    gst_query_parse_latency (query, &live, &min, &max);
+    if (GST_VIDEO_INFO_FPS_N (info) > 0)
+      latency = gst_util_uint64_scale_int (
+          filter->pipeline_depth * GST_SECOND, GST_VIDEO_INFO_FPS_D (info),
+          GST_VIDEO_INFO_FPS_N (info));
+    GST_DEBUG ("Adding %" GST_TIME_FORMAT " of latency for %d frames held "
+        "back.", GST_TIME_ARGS (latency), filter->pipeline_depth);
+    min += latency;
+    if (GST_CLOCK_TIME_IS_VALID (max))
+      max += latency;
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  return ret;
+}
+
+static gboolean
+gst_cheese_face_detect_stop (GstBaseTransform * trans)
+{
+  GstBaseTransformClass *bclass =
+      GST_BASE_TRANSFORM_CLASS (gst_cheese_face_detect_parent_class);
+
+  gst_cheese_face_detect_async_stop (GST_CHEESEFACEDETECT (trans));
+  gst_cheese_face_detect_pipeline_stop (GST_CHEESEFACEDETECT (trans));
+
+  if (bclass->stop)
+    return bclass->stop (trans);
+  return TRUE;
+}
+
 static void
 gst_cheese_face_detect_finalize (GObject * obj)
 {
   GstCheeseFaceDetect *filter = GST_CHEESEFACEDETECT (obj);
 
+  gst_cheese_face_detect_async_stop (filter);
+  g_array_unref (filter->async_removed_faces);
+  g_mutex_clear (&filter->async_lock);
+  g_cond_clear (&filter->async_cond);
+  gst_cheese_face_detect_pipeline_stop (filter);
+  g_queue_free (filter->pipeline_jobs);
+  g_mutex_clear (&filter->pipeline_lock);
+  g_cond_clear (&filter->pipeline_cond);
+  g_mutex_clear (&filter->roi_lock);
+  delete filter->roi_windows;
+
   if (filter->face_detector)
     delete filter->face_detector;
+  if (filter->motion_gate)
+    delete filter->motion_gate;
+  if (filter->luma_scaler)
+    delete filter->luma_scaler;
+  if (filter->scratch_pool)
+    delete filter->scratch_pool;
+  if (filter->arena)
+    delete filter->arena;
+  if (filter->assignment)
+    delete filter->assignment;
   if (filter->shape_predictor)
     delete filter->shape_predictor;
+  g_free (filter->landmark);
   if (filter->camera_matrix)
     delete filter->camera_matrix;
   if (filter->dist_coeffs)
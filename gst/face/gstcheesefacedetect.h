@@ -53,6 +53,7 @@
 #include <graphene.h>
 #include <graphene-gobject.h>
 #include <gst/opencv/gstopencvvideofilter.h>
+#include <gst/cheese/face/cheesemultifaceinfo.h>
 
 #include "opencv2/opencv.hpp"
 #include <opencv2/core/core_c.h>
@@ -69,9 +70,15 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <math.h>
 
-#include "Hungarian.h"
+#include "arena.h"
+#include "facedetector.h"
+#include "gating.h"
+#include "lumascaler.h"
+#include "motiongate.h"
+#include "scratchpool.h"
 
 G_BEGIN_DECLS
 
@@ -104,17 +111,26 @@ typedef void (* CheeseFaceFreeFunc) (gpointer);
 struct CheeseFace {
   public:
     cv::Point centroid;
+    /* Displacement of the centroid per frame between the last detections. */
+    cv::Point motion;
     dlib::rectangle bounding_box;
     dlib::rectangle scaled_bounding_box;
     guint last_detected_frame;
 
     std::vector<cv::Point> landmark;
 
+    /* Pose estimation, only meaningful if has_pose is TRUE. */
+    gboolean has_pose;
+    cv::Point2d pose_axis_origin;
+    cv::Point2d pose_axis[3];
+    graphene_point3d_t pose_euler_angles;
+
     gpointer user_data;
     CheeseFaceFreeFunc free_user_data_func;
 
     CheeseFace ()
     {
+        has_pose = FALSE;
         user_data = NULL;
         free_user_data_func = NULL;
     }
@@ -126,6 +142,56 @@ struct CheeseFace {
     }
 };
 
+/**
+ * The properties a frame is processed with. They are copied under the object
+ * lock when the frame is queued, so the threads processing it never read the
+ * element while its properties are set.
+ **/
+struct CheeseFaceDetectSettings {
+  gboolean display_bounding_box;
+  gboolean display_id;
+  gboolean display_landmark;
+  gboolean display_pose_estimation;
+  gboolean use_hungarian;
+  gboolean use_pose_estimation;
+  guint hungarian_delete_threshold;
+  gdouble distance_factor;
+  gfloat scale_factor;
+  gfloat coarse_scale_factor;
+  guint tile_size;
+  guint tile_overlap;
+  guint full_scan_interval;
+  gdouble motion_threshold;
+  /* Shared, so a new model can be set while the job still uses the old one. */
+  std::shared_ptr<dlib::shape_predictor> shape_predictor;
+};
+
+/**
+ * Everything needed to process a single frame. In synchronous mode it just
+ * wraps the frame being transformed, in asynchronous mode it owns a copy of
+ * the frame handed to the background thread and in pipelined mode it holds
+ * the buffer back, mapped, until all the stages are done.
+ **/
+struct CheeseFaceDetectJob {
+  cv::Mat frame;
+  cv::Mat resized_frame;
+  /* scale of resized_frame with respect to frame */
+  gdouble scale_factor;
+  std::vector<dlib::rectangle> dets;
+  CheeseFaceDetectSettings settings;
+
+  GstClockTime pts;
+  GstClockTime duration;
+  GstClockTime stream_time;
+  GstClockTime running_time;
+  /* pipelined mode only */
+  GstBuffer *buffer;
+  GstVideoFrame video_frame;
+  cv::Mat scratch;
+  gboolean done;
+  GstFlowReturn ret;
+};
+
 /*
 struct CheeseFaceInfo {
   graphene_point_t centroid;
@@ -148,11 +214,27 @@ struct _GstCheeseFaceDetect
   gboolean use_hungarian;
   gboolean use_pose_estimation;
   guint hungarian_delete_threshold;
+  gdouble distance_factor;
   gfloat scale_factor;
+  gfloat coarse_scale_factor;
+  gboolean async;
+  guint pipeline_depth;
+  guint tile_size;
+  guint tile_overlap;
+  guint full_scan_interval;
+  gdouble motion_threshold;
 
   /* private props */
-  dlib::frontal_face_detector *face_detector;
-  dlib::shape_predictor *shape_predictor;
+  CheeseFaceDetector *face_detector;
+  CheeseMotionGate *motion_gate;
+  CheeseLumaScaler *luma_scaler;
+  /* Frame sized images, sized after the caps. Subclasses add their slots. */
+  CheeseScratchPool *scratch_pool;
+  /* Bookkeeping of the frame being updated, reset once it is done. */
+  CheeseArena *arena;
+  CheeseGatedAssignment *assignment;
+  /* Only touched under the object lock. */
+  std::shared_ptr<dlib::shape_predictor> *shape_predictor;
   std::vector<cv::Point3d> *pose_model_points;
 
   guint last_face_id;
@@ -162,6 +244,34 @@ struct _GstCheeseFaceDetect
 
   cv::Mat *camera_matrix;
   cv::Mat *dist_coeffs;
+
+  /* Detection windows around the known faces, in frame coordinates. Written
+   * once the faces are updated and read by the next detection, which may run
+   * on another thread. */
+  GMutex roi_lock;
+  std::vector<cv::Rect> *roi_windows;
+  gboolean roi_full_scan;
+  guint roi_frames;
+
+  /* async mode, everything below is protected by async_lock */
+  GThread *async_thread;
+  GMutex async_lock;
+  GCond async_cond;
+  gboolean async_stop;
+  CheeseFaceDetectJob *async_job;
+  GstCheeseMultifaceInfo *async_result;
+  GArray *async_removed_faces;
+  GstClockTime async_result_pts;
+
+  /* pipelined mode, jobs are queued in arrival order */
+  GThreadPool *pipeline_detect_pool;
+  GThreadPool *pipeline_update_pool;
+  GMutex pipeline_lock;
+  GCond pipeline_cond;
+  GQueue *pipeline_jobs;
+  /* Job whose faces were detected, being finished by the cv_trans_ip_func
+   * of the class. Only touched by the update stage. */
+  CheeseFaceDetectJob *pipeline_job;
 };
 
 struct _GstCheeseFaceDetectClass 
@@ -74,6 +74,7 @@
 #include <vector>
 
 #include "gstcheesefaceomelette.h"
+#include "videoframe.h"
 
 using namespace std;
 using namespace cv;
@@ -136,13 +137,13 @@ enum
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGB"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (CHEESE_VIDEO_FRAME_FORMATS))
     );
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGB"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (CHEESE_VIDEO_FRAME_FORMATS))
     );
 
 #define gst_cheese_face_omelette_parent_class parent_class
@@ -154,9 +155,28 @@ static void gst_cheese_face_omelette_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
 static void gst_cheese_face_omelette_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
+static gboolean gst_cheese_face_omelette_set_info (GstVideoFilter * vfilter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
 static GstFlowReturn gst_cheese_face_omelette_transform_ip (
     GstOpencvVideoFilter * filter, GstBuffer * buf, cv::Mat img);
 
+/* Scratch images, numbered after the ones of cheesefacedetect. */
+enum
+{
+  /* Frame sized */
+  OMELETTE_SCRATCH_MASK = CHEESE_SCRATCH_POOL_USER,
+  OMELETTE_SCRATCH_MASK_VICTIM,
+  OMELETTE_SCRATCH_MASK_FLOAT,
+  OMELETTE_SCRATCH_MASK_VICTIM_FLOAT,
+  OMELETTE_SCRATCH_RESULT,
+  /* Overlay sized */
+  OMELETTE_SCRATCH_IMAGE_BGRA,
+  OMELETTE_SCRATCH_IMAGE_ALPHA,
+  OMELETTE_SCRATCH_IMAGE,
+  OMELETTE_SCRATCH_IMAGE_MASK
+};
+
 /* Omelette per face data */
 static OmeletteData * omelette_data_new (GstCheeseFaceOmelette * filter);
 static void omelette_data_free (gpointer user_data);
@@ -240,6 +260,7 @@ gst_cheese_face_omelette_class_init (GstCheeseFaceOmeletteClass * klass)
 {
   GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
+  GstVideoFilterClass *gstvideofilter_class;
   GstOpencvVideoFilterClass *gstopencvbasefilter_class;
   GstCheeseFaceDetectClass *gstcheesefacedetect_class;
 
@@ -248,9 +269,12 @@ gst_cheese_face_omelette_class_init (GstCheeseFaceOmeletteClass * klass)
 
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
+  gstvideofilter_class = (GstVideoFilterClass *) klass;
   gstopencvbasefilter_class = (GstOpencvVideoFilterClass *) klass;
   gstcheesefacedetect_class = (GstCheeseFaceDetectClass *) klass;
 
+  gstvideofilter_class->set_info =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_omelette_set_info);
   gstopencvbasefilter_class->cv_trans_ip_func =
       gst_cheese_face_omelette_transform_ip;
   gstcheesefacedetect_class->cheese_face_free_user_data_func =
@@ -368,70 +392,108 @@ gst_cheese_face_omelette_get_property (GObject * object, guint prop_id,
 
 static void
 gst_cheese_face_omelette_select_image (GstCheeseFaceOmelette * filter,
-    OmeletteData * omelette_data, cv::UMat & image, cv::UMat & image_mask,
-    cv::Size & image_size, float scale_factor, float fit_factor)
+    OmeletteData * omelette_data, cv::Mat & image, cv::Mat & image_mask,
+    float scale_factor, float fit_factor, gint channels)
 {
+  CheeseScratchPool *pool = GST_CHEESEFACEDETECT (filter)->scratch_pool;
+  cv::UMat *overlay = NULL;
+  cv::Mat bgra, alpha;
+  cv::Size size;
+
   scale_factor *= fit_factor;
   /* Decide what image to show */
   switch (omelette_data->turn) {
     case OMELETTE_ANIMATION_TURN_OMELETTE:
-      cv::resize (*filter->omelette, image, cv::Size (), scale_factor,
-          scale_factor);
+      overlay = filter->omelette;
       break;
     case OMELETTE_ANIMATION_TURN_OMELETTE_OREGANO:
-      cv::resize (*filter->omelette_oregano, image, cv::Size (),
-          scale_factor, scale_factor);
+      overlay = filter->omelette_oregano;
       break;
     case OMELETTE_ANIMATION_TURN_TOMATO:
-      cv::resize (*filter->tomatoes[omelette_data->tomato_counter - 1],
-          image, cv::Size (), scale_factor, scale_factor);
+      overlay = filter->tomatoes[omelette_data->tomato_counter - 1];
       break;
     case OMELETTE_ANIMATION_TURN_CHEESE:
-      cv::resize (*filter->cheeses[omelette_data->cheese_counter - 1],
-          image, cv::Size (), scale_factor, scale_factor);
+      overlay = filter->cheeses[omelette_data->cheese_counter - 1];
       break;
   }
-  image_size = image.size ();
+  size = cv::Size (cvRound (overlay->cols * scale_factor),
+      cvRound (overlay->rows * scale_factor));
+  bgra = pool->get (OMELETTE_SCRATCH_IMAGE_BGRA, size, overlay->type ());
+  cv::resize (*overlay, bgra, size);
+
   /* TODO */
   /* It is obvious that images have alpha channel but validate anyway */
-  cv::extractChannel (image, image_mask, 3);
-  cv::cvtColor(image_mask, image_mask, CV_GRAY2RGB);
-  cv::cvtColor(image, image, CV_BGR2RGB);
+  image = pool->get (OMELETTE_SCRATCH_IMAGE, size, CV_8UC (channels));
+  image_mask = pool->get (OMELETTE_SCRATCH_IMAGE_MASK, size,
+      CV_8UC (channels));
+  /* Only the luma plane of YUV and GRAY8 frames is drawn on. */
+  if (channels == 1) {
+    cv::extractChannel (bgra, image_mask, 3);
+    cv::cvtColor (bgra, image, CV_BGRA2GRAY);
+  } else {
+    alpha = pool->get (OMELETTE_SCRATCH_IMAGE_ALPHA, size, CV_8UC1);
+    cv::extractChannel (bgra, alpha, 3);
+    cv::cvtColor (alpha, image_mask, CV_GRAY2RGB);
+    cv::cvtColor (bgra, image, CV_BGR2RGB);
+  }
 }
 
+/* The polygons have a fixed number of points, so they live on the stack. */
 static void
 _cheese_face_create_face_polygons (CheeseFace & face,
-    std::vector<cv::Point> & face_lips_internal_pts,
-    std::vector<cv::Point> & face_left_eye_internal_pts,
-    std::vector<cv::Point> & face_right_eye_internal_pts)
+    cv::Point * face_lips_internal_pts,
+    cv::Point * face_left_eye_internal_pts,
+    cv::Point * face_right_eye_internal_pts)
 {
   guint i;
   for (i = 0; i < G_N_ELEMENTS (FACE_LIPS_INTERNAL_BORDER); i++)
-    face_lips_internal_pts.push_back (
-        face.landmark[FACE_LIPS_INTERNAL_BORDER[i] - 1]);
+    face_lips_internal_pts[i] =
+        face.landmark[FACE_LIPS_INTERNAL_BORDER[i] - 1];
   for (i = 0; i < G_N_ELEMENTS (FACE_LEFT_EYE_BORDER); i++)
-    face_left_eye_internal_pts.push_back (
-        face.landmark[FACE_LEFT_EYE_BORDER[i] - 1]);
+    face_left_eye_internal_pts[i] =
+        face.landmark[FACE_LEFT_EYE_BORDER[i] - 1];
   for (i = 0; i < G_N_ELEMENTS (FACE_RIGHT_EYE_BORDER); i++)
-    face_right_eye_internal_pts.push_back (
-        face.landmark[FACE_RIGHT_EYE_BORDER[i] - 1]);
+    face_right_eye_internal_pts[i] =
+        face.landmark[FACE_RIGHT_EYE_BORDER[i] - 1];
 }
 
 static void
-_draw_polygons_to_mask (cv::UMat & umask,
-    std::vector<cv::Point> & face_lips_internal_pts,
-    std::vector<cv::Point> & face_left_eye_internal_pts,
-    std::vector<cv::Point> & face_right_eye_internal_pts)
+_draw_polygons_to_mask (cv::Mat & mask,
+    cv::Point * face_lips_internal_pts,
+    cv::Point * face_left_eye_internal_pts,
+    cv::Point * face_right_eye_internal_pts)
 {
-  /* Do I really have to convert it to a cv::Mat ? */
-  cv::Mat mask = umask.getMat (cv::ACCESS_WRITE);
-  cv::fillConvexPoly (mask, &face_lips_internal_pts[0],
-      face_lips_internal_pts.size (), BLACK);
-  cv::fillConvexPoly (mask, &face_left_eye_internal_pts[0],
-      face_left_eye_internal_pts.size (), BLACK);
-  cv::fillConvexPoly (mask, &face_right_eye_internal_pts[0],
-      face_right_eye_internal_pts.size (), BLACK);
-  umask = mask.getUMat (cv::ACCESS_WRITE);
+  cv::fillConvexPoly (mask, face_lips_internal_pts,
+      G_N_ELEMENTS (FACE_LIPS_INTERNAL_BORDER), BLACK);
+  cv::fillConvexPoly (mask, face_left_eye_internal_pts,
+      G_N_ELEMENTS (FACE_LEFT_EYE_BORDER), BLACK);
+  cv::fillConvexPoly (mask, face_right_eye_internal_pts,
+      G_N_ELEMENTS (FACE_RIGHT_EYE_BORDER), BLACK);
+}
+
+static gboolean
+gst_cheese_face_omelette_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstVideoFilterClass *bclass =
+      GST_VIDEO_FILTER_CLASS (gst_cheese_face_omelette_parent_class);
+  CheeseScratchPool *pool = GST_CHEESEFACEDETECT (vfilter)->scratch_pool;
+  const gint channels = cheese_video_frame_channels (in_info);
+
+  if (!bclass->set_info (vfilter, incaps, in_info, outcaps, out_info))
+    return FALSE;
+
+  pool->reserve (OMELETTE_SCRATCH_MASK, CV_8UC (channels));
+  pool->reserve (OMELETTE_SCRATCH_MASK_VICTIM, CV_8UC (channels));
+  pool->reserve (OMELETTE_SCRATCH_MASK_FLOAT, CV_32FC (channels));
+  pool->reserve (OMELETTE_SCRATCH_MASK_VICTIM_FLOAT, CV_32FC (channels));
+  pool->reserve (OMELETTE_SCRATCH_RESULT, CV_32FC (channels));
+  /* The overlays fit the faces, so they are hardly ever larger. */
+  pool->reserve (OMELETTE_SCRATCH_IMAGE_BGRA, CV_8UC4);
+  pool->reserve (OMELETTE_SCRATCH_IMAGE_ALPHA, CV_8UC1);
+  pool->reserve (OMELETTE_SCRATCH_IMAGE, CV_8UC (channels));
+  pool->reserve (OMELETTE_SCRATCH_IMAGE_MASK, CV_8UC (channels));
+  return TRUE;
 }
 
 static GstFlowReturn
@@ -445,13 +507,29 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
     GST_OPENCV_VIDEO_FILTER_CLASS (gst_cheese_face_omelette_parent_class);
   GstCheeseFaceDetect *parent_filter = GST_CHEESEFACEDETECT (base);
   GstCheeseFaceOmelette *filter = GST_CHEESEFACEOMELETTE (base);
+  gboolean has_landmark;
 
-  if (filter->resources_loaded && parent_filter->shape_predictor)
+  GST_OBJECT_LOCK (parent_filter);
+  has_landmark = !!*parent_filter->shape_predictor;
+  GST_OBJECT_UNLOCK (parent_filter);
+
+  if (filter->resources_loaded && has_landmark)
     ret = bclass->cv_trans_ip_func (base, buf, cvImg);
 
+  /* In async mode the faces belong to the detection thread, the pipelined
+   * mode calls us from the thread that owns them. */
+  if (ret == GST_FLOW_OK && parent_filter->async &&
+      !parent_filter->pipeline_job) {
+    GST_LOG ("The omelette is not drawn in async mode.");
+    return ret;
+  }
+
   if (ret == GST_FLOW_OK) {
     cv::Size sz = cvImg.size ();
     cv::Rect rect (cv::Point (0, 0), sz);
+    const gint type = CV_8UC (cvImg.channels ());
+    const gint float_type = CV_32FC (cvImg.channels ());
+    CheeseScratchPool *pool = parent_filter->scratch_pool;
     /* Dumbness */
     gint64 time_start;
     gint64 time_animation_counter = 0, time_copy_frame = 0, time_polygons = 0;
@@ -461,12 +539,12 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
 
     if (debug)
       time_start = cv::getTickCount ();
-    cv::UMat mask(sz.height, sz.width, CV_8UC3, BLACK);
+    cv::Mat mask = pool->get (OMELETTE_SCRATCH_MASK, sz, type);
     /* The image that will be masked */
-    cv::UMat mask_victim (sz.height, sz.width, CV_8UC3, BLACK);
-    /* The mask_victim with mask applied? */
-    cv::UMat masked (sz.height, sz.width, CV_8UC3, BLACK);
-    //uImg = cvImg.getUMat (cv::ACCESS_WRITE);
+    cv::Mat mask_victim = pool->get (OMELETTE_SCRATCH_MASK_VICTIM, sz,
+        type);
+    mask.setTo (BLACK);
+    mask_victim.setTo (BLACK);
     if (debug)
       time_create_black_frame = cv::getTickCount () - time_start;
 
@@ -488,8 +566,7 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
        * If two or more detected faces are very close then the bounding box
        * of one of the images clouds the other image. What should be done
        * is to blend all the overlay images, or at least that is what I think.
-       * This isn't critical but it gives a bad effect. Also, if one image is
-       * should be overlayed out of the bounds of the frames it won't be drawn.
+       * This isn't critical but it gives a bad effect.
        */
       if (debug)
         time_per_face_start = cv::getTickCount ();;
@@ -512,16 +589,20 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
         const float scale_factor =
             face.bounding_box.width () / (gfloat) filter->omelette->cols;
         /* Images */
-        cv::UMat image, image_mask;
+        cv::Mat image, image_mask;
         cv::Size image_size;
         /* Points to build polygons */
-        std::vector<cv::Point> face_lips_internal_pts;
-        std::vector<cv::Point> face_left_eye_internal_pts;
-        std::vector<cv::Point> face_right_eye_internal_pts;
+        cv::Point face_lips_internal_pts[
+            G_N_ELEMENTS (FACE_LIPS_INTERNAL_BORDER)];
+        cv::Point face_left_eye_internal_pts[
+            G_N_ELEMENTS (FACE_LEFT_EYE_BORDER)];
+        cv::Point face_right_eye_internal_pts[
+            G_N_ELEMENTS (FACE_RIGHT_EYE_BORDER)];
         /* ROIs */
         cv::Rect mask_victim_rect_ROI;
-        cv::UMat mask_victim_ROI;
-        cv::UMat mask_ROI;
+        cv::Rect image_rect_ROI;
+        cv::Mat mask_victim_ROI;
+        cv::Mat mask_ROI;
         cv::Point nose_point = face.landmark[FACE_NOSE_POINT - 1];
         cv::Point image_offset;
 
@@ -535,7 +616,8 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
         if (debug)
           time_start = cv::getTickCount ();
         gst_cheese_face_omelette_select_image (filter, omelette_data, image,
-            image_mask, image_size, scale_factor, DEFAULT_FIT_FACTOR);
+            image_mask, scale_factor, DEFAULT_FIT_FACTOR, cvImg.channels ());
+        image_size = image.size ();
         if (debug)
           time_select_image += cv::getTickCount () - time_start;
 
@@ -546,9 +628,11 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
         mask_victim_rect_ROI = cv::Rect (image_offset, image_size) & rect;
         mask_victim_ROI = mask_victim (mask_victim_rect_ROI);
         mask_ROI = mask (mask_victim_rect_ROI);
+        /* The part of the image left inside the frame */
+        image_rect_ROI = mask_victim_rect_ROI - image_offset;
 
-        image.copyTo (mask_victim_ROI);
-        image_mask.copyTo (mask_ROI);
+        image (image_rect_ROI).copyTo (mask_victim_ROI);
+        image_mask (image_rect_ROI).copyTo (mask_ROI);
 
         if (debug)
           time_start = cv::getTickCount ();
@@ -569,23 +653,27 @@ gst_cheese_face_omelette_transform_ip (GstOpencvVideoFilter * base,
       if (debug)
         time_start = cv::getTickCount ();
 
-      cv::UMat result;
-      mask_victim.convertTo (mask_victim, CV_32FC3);
+      cv::Mat mask_float =
+          pool->get (OMELETTE_SCRATCH_MASK_FLOAT, sz, float_type);
+      cv::Mat mask_victim_float =
+          pool->get (OMELETTE_SCRATCH_MASK_VICTIM_FLOAT, sz, float_type);
+      cv::Mat result = pool->get (OMELETTE_SCRATCH_RESULT, sz, float_type);
+      mask_victim.convertTo (mask_victim_float, CV_32F);
       /* Set mask pixel channels values between 0.0 and 1.0 */
-      mask.convertTo(mask, CV_32FC3, 1.0 / 255);
-      cvImg.convertTo (result, CV_32FC3);
+      mask.convertTo (mask_float, CV_32F, 1.0 / 255);
+      cvImg.convertTo (result, CV_32F);
 
       /* Weight foreground */
-      cv::multiply (mask, mask_victim, mask_victim);
+      cv::multiply (mask_float, mask_victim_float, mask_victim_float);
       /* Invert the mask */
-      cv::subtract (cv::Scalar::all(1.0), mask, mask);
+      cv::subtract (cv::Scalar::all(1.0), mask_float, mask_float);
       /* Weight background */
-      cv::multiply (mask, result, result);
+      cv::multiply (mask_float, result, result);
       /* Blend foreground and background */
-      cv::add(mask_victim, result, result);
+      cv::add(mask_victim_float, result, result);
 
-      result.convertTo (result, CV_8UC3);
-      result.copyTo (cvImg);
+      /* Straight into the frame */
+      result.convertTo (cvImg, CV_8U);
       if (debug)
         time_copy_frame += cv::getTickCount () - time_start;
 
@@ -75,8 +75,18 @@
 #include <math.h>
 
 #include "gstcheesefacetrack.h"
+#include "facedetector.h"
+#include "arena.h"
+#include "cameramotion.h"
 #include "facetrack.h"
+#include "flowpyramid.h"
+#include "gating.h"
+#include "landmarkflow.h"
+#include "lumascaler.h"
+#include "motiongate.h"
 #include "utils.h"
+#include "videoframe.h"
+#include "workerpool.h"
 
 using namespace std;
 using namespace dlib;
@@ -88,8 +98,59 @@ static void gst_cheese_face_track_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
 static void gst_cheese_face_track_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
+static gboolean gst_cheese_face_track_set_info (GstVideoFilter * vfilter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static GstFlowReturn gst_cheese_face_track_transform_frame_ip (
+    GstVideoFilter * vfilter, GstVideoFrame * frame);
 static GstFlowReturn gst_cheese_face_track_transform_ip (
     GstOpencvVideoFilter * filter, GstBuffer * buf, cv::Mat cv_img);
+static gboolean gst_cheese_face_track_stop (GstBaseTransform * trans);
+
+enum
+{
+  /* The color frame given to GOTURN. */
+  TRACK_SCRATCH_TRACKER = CHEESE_SCRATCH_POOL_USER
+};
+
+/* The properties a detection phase runs with. */
+struct CheeseFaceTrackDetectParams {
+  guint max_threads;
+  guint tile_size;
+  guint tile_overlap;
+  gdouble motion_threshold;
+};
+
+/**
+ * A detection phase run by the background thread on a snapshot of a frame,
+ * with where the faces were at the snapshot. The properties are those of
+ * the snapshot, the thread never reads the element's.
+ **/
+struct CheeseFaceTrackDetectJob {
+  cv::Mat frame;
+  guint frame_number;
+  CheeseFaceTrackDetectParams params;
+  std::vector<guint> face_ids;
+  std::vector<cv::Point> face_centroids;
+  std::vector<gfloat> face_radii;
+  std::vector<dlib::rectangle> dets;
+  /* Set by the background thread, protected by async_lock. */
+  gboolean done;
+  /* More frames went by than can be caught up with. */
+  gboolean stale;
+};
+
+/**
+ * A hit of the detector during a sweep, with the face nearest to it on the
+ * frame its slice was scanned in and where that face was, so the hit can
+ * follow the face until the sweep is over.
+ **/
+struct CheeseFaceTrackSweepDet {
+  dlib::rect_detection hit;
+  gboolean has_face;
+  guint face_id;
+  cv::Point face_centroid;
+};
 
 struct _GstCheeseFaceTrack
 {
@@ -107,15 +168,63 @@ struct _GstCheeseFaceTrack
   gfloat scale_factor;
   gdouble distance_factor;
   guint detection_gap_duration;
+  guint max_threads;
+  guint tile_size;
+  guint tile_overlap;
+  gdouble motion_threshold;
+  gdouble static_threshold;
+  gdouble scene_cut_threshold;
+  guint coast_duration;
+  gboolean compensate_camera_motion;
+  guint landmark_interval;
+  gboolean local_redetect;
+  gdouble min_confidence;
+  gboolean async_detection;
+  guint detection_slices;
 
   /* private props */
-  dlib::frontal_face_detector *face_detector;
+  CheeseFaceDetector *face_detector;
+  CheeseMotionGate *motion_gate;
+  CheeseLumaScaler *luma_scaler;
+  CheeseScratchPool *scratch_pool;
+  /* Bookkeeping of the frame being transformed, reset once it is done. */
+  CheeseArena *arena;
+  CheeseGatedAssignment *assignment;
+  CheeseSceneChange *scene_change;
+  CheeseCameraMotion *camera_motion;
+  /* Shared by the median flow trackers and the landmark flow. */
+  CheeseFlowPyramid *flow_pyramid;
+  /* Trackers of the faces, ready before the faces need them. */
+  CheeseTrackerPool *tracker_pool;
+  gdouble accumulated_change;
   dlib::shape_predictor *shape_predictor;
 
   guint last_face_id;
   guint frame_number;
   std::map<guint, CheeseFace> *faces;
   GHashTable *face_table;
+
+  /* Background detection. The job is only touched by the background thread
+   * until it is done, its done flag is protected by async_lock. */
+  GThread *async_thread;
+  GMutex async_lock;
+  GCond async_cond;
+  gboolean async_stop;
+  CheeseFaceTrackDetectJob *async_job;
+  /* Only used by the background thread, or once it is stopped. */
+  CheeseFaceDetector *async_detector;
+  CheeseMotionGate *async_motion_gate;
+  /* Tracker frames since the snapshot of the job, which is the first one. */
+  std::vector<cv::Mat> *async_frames;
+  guint async_n_frames;
+  /* Pyramids of the replayed frames, shared by the faces catching up. */
+  CheeseFlowPyramid *async_pyramid;
+
+  /* Detection sweep, one slice of the image pyramid scanned per frame. */
+  gboolean sweep_running;
+  guint sweep_slice;
+  guint sweep_n_slices;
+  std::vector<CheeseFaceTrackSweepDet> *sweep_dets;
 };
 
 struct _GstCheeseFaceTrackClass
@@ -143,6 +252,12 @@ gst_cheese_face_track_tracker_get_type (void)
       { GST_CHEESEFACETRACK_TRACKER_MIL, "Multiple Instance Learning", "mil" },
       { GST_CHEESEFACETRACK_TRACKER_TLD, "Tracking Learning Detection",
           "tld" },
+      { GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW,
+          "Median Flow sharing one pyramid for all faces",
+          "shared-median-flow" },
+      { GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE,
+          "MOSSE correlation filters of all faces in one batch",
+          "batched-mosse" },
       { 0, NULL, NULL }
     };
 
@@ -157,6 +272,30 @@ gst_cheese_face_track_tracker_get_type (void)
 #define DEFAULT_TRACKER                                   GST_CHEESEFACETRACK_TRACKER_MEDIANFLOW
 #define DEFAULT_DETECTION_GAP_DURATION                    10
 #define DEFAULT_DISTANCE_FACTOR                           10.0
+#define DEFAULT_MAX_THREADS                               0
+#define DEFAULT_TILE_SIZE                                 0
+#define DEFAULT_TILE_OVERLAP                              160
+#define DEFAULT_MOTION_THRESHOLD                          0.0
+#define DEFAULT_STATIC_THRESHOLD                          0.0
+#define DEFAULT_SCENE_CUT_THRESHOLD                       0.0
+#define DEFAULT_COAST_DURATION                            10
+#define DEFAULT_COMPENSATE_CAMERA_MOTION                  FALSE
+#define DEFAULT_LANDMARK_INTERVAL                         1
+#define DEFAULT_LOCAL_REDETECT                            TRUE
+#define DEFAULT_MIN_CONFIDENCE                            0.3
+#define DEFAULT_ASYNC_DETECTION                           FALSE
+/* Frames a background detection may take, at most, to be caught up with. */
+#define ASYNC_MAX_CATCHUP_FRAMES                          30
+/* Kept frames replayed, at most, when catching up with one, the others are
+ * skipped evenly. */
+#define ASYNC_MAX_REPLAY_FRAMES                           8
+#define DEFAULT_DETECTION_SLICES                          1
+/* Margin around a weak track, relative to its size, that is searched for
+ * its face again. */
+#define LOCAL_REDETECT_MARGIN                             0.5
+/* Trackers start again when the camera moves their face farther than this
+ * fraction of its width. */
+#define CAMERA_MOTION_RESTART_FACTOR                      0.25
 #define DEFAULT_BOUNDING_BOX_DETECT_COLOR                 cv::Scalar (255, 255, 0)
 #define DEFAULT_BOUNDING_BOX_TRACK_COLOR                  cv::Scalar (0, 255, 0)
 #define DEFAULT_LANDMARK_COLOR                            cv::Scalar (255, 140, 0)
@@ -188,7 +327,20 @@ enum
   PROP_DELETE_THRESHOLD,
   PROP_SCALE_FACTOR,
   PROP_DISTANCE_FACTOR,
-  PROP_DETECTION_GAP_DURATION
+  PROP_DETECTION_GAP_DURATION,
+  PROP_MAX_THREADS,
+  PROP_TILE_SIZE,
+  PROP_TILE_OVERLAP,
+  PROP_MOTION_THRESHOLD,
+  PROP_STATIC_THRESHOLD,
+  PROP_SCENE_CUT_THRESHOLD,
+  PROP_COAST_DURATION,
+  PROP_COMPENSATE_CAMERA_MOTION,
+  PROP_LANDMARK_INTERVAL,
+  PROP_LOCAL_REDETECT,
+  PROP_MIN_CONFIDENCE,
+  PROP_ASYNC_DETECTION,
+  PROP_DETECTION_SLICES
 };
 
 // static dlib::frontal_face_detector mydetector = get_frontal_face_detector();
@@ -200,13 +352,13 @@ enum
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGB"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (CHEESE_VIDEO_FRAME_FORMATS))
     );
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGB"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (CHEESE_VIDEO_FRAME_FORMATS))
     );
 
 #define gst_cheese_face_track_parent_class parent_class
@@ -221,6 +373,8 @@ gst_cheese_face_track_class_init (GstCheeseFaceTrackClass * klass)
 {
   GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
+  GstBaseTransformClass *gstbasetransform_class;
+  GstVideoFilterClass *gstvideofilter_class;
   GstOpencvVideoFilterClass *gstopencvbasefilter_class;
 
   GST_DEBUG_CATEGORY_INIT (gst_cheese_face_track_debug, "gstcheesefacetrack",
@@ -230,8 +384,15 @@ gst_cheese_face_track_class_init (GstCheeseFaceTrackClass * klass)
 
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
+  gstbasetransform_class = (GstBaseTransformClass *) klass;
+  gstvideofilter_class = (GstVideoFilterClass *) klass;
   gstopencvbasefilter_class = (GstOpencvVideoFilterClass *) klass;
 
+  gstbasetransform_class->stop = GST_DEBUG_FUNCPTR (gst_cheese_face_track_stop);
+  gstvideofilter_class->set_info =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_track_set_info);
+  gstvideofilter_class->transform_frame_ip =
+      GST_DEBUG_FUNCPTR (gst_cheese_face_track_transform_frame_ip);
   gstopencvbasefilter_class->cv_trans_ip_func =
       gst_cheese_face_track_transform_ip;
 
@@ -299,6 +460,113 @@ gst_cheese_face_track_class_init (GstCheeseFaceTrackClass * klass)
           "Sets the maximum number of frames between each detection phase.",
           1, G_MAXUINT, DEFAULT_DETECTION_GAP_DURATION,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum number of threads",
+          "Sets the maximum number of threads used to update the trackers and "
+          "the landmarks of the faces. 0 uses one thread per processor.",
+          0, G_MAXUINT, DEFAULT_MAX_THREADS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TILE_SIZE,
+      g_param_spec_uint ("tile-size", "Tile size",
+          "Sets the size in pixels of the square tiles the scaled frame is "
+          "split into, each tile is scanned for faces on its own core. "
+          "Sizes below the 80 pixels of the detection window are raised to "
+          "it. 0 scans the whole frame at once.",
+          0, G_MAXUINT, DEFAULT_TILE_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TILE_OVERLAP,
+      g_param_spec_uint ("tile-overlap", "Tile overlap",
+          "Sets the overlap in pixels between neighbouring tiles. Faces "
+          "bigger than the overlap may be cut by a tile seam.",
+          0, G_MAXUINT, DEFAULT_TILE_OVERLAP,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MOTION_THRESHOLD,
+      g_param_spec_double ("motion-threshold", "Motion threshold",
+          "Sets the mean luma difference, from 0 to 255, above which a tile "
+          "of the frame is considered changed. Only the changed tiles, and "
+          "a margin around them, are scanned for faces. The faces found "
+          "elsewhere are kept from the previous scans. 0 scans the whole "
+          "frame.",
+          0.0, 255.0, DEFAULT_MOTION_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_STATIC_THRESHOLD,
+      g_param_spec_double ("static-threshold", "Static threshold",
+          "Sets the mean luma change of the frame, from 0 to 255, added up "
+          "since the last detection phase, below which the scene is "
+          "considered static and the next scheduled detection phase is "
+          "skipped. 0 never skips them.",
+          0.0, 255.0, DEFAULT_STATIC_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_SCENE_CUT_THRESHOLD,
+      g_param_spec_double ("scene-cut-threshold", "Scene cut threshold",
+          "Sets the mean luma change between two frames, from 0 to 255, "
+          "above which a detection phase is forced right away. 0 disables "
+          "it.",
+          0.0, 255.0, DEFAULT_SCENE_CUT_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_COAST_DURATION,
+      g_param_spec_uint ("coast-duration", "Coast duration",
+          "Sets the number of frames a face whose tracker lost its target "
+          "keeps following its predicted motion, waiting for the next "
+          "detection phase, before a detection phase is forced. 0 forces it "
+          "right away.",
+          0, G_MAXUINT, DEFAULT_COAST_DURATION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class,
+      PROP_COMPENSATE_CAMERA_MOTION,
+      g_param_spec_boolean ("compensate-camera-motion",
+          "Compensate camera motion",
+          "Sets whether to estimate the motion of the camera on every frame "
+          "and move all the faces along with it before their trackers are "
+          "updated. Useful with handheld or moving cameras.",
+          DEFAULT_COMPENSATE_CAMERA_MOTION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_LANDMARK_INTERVAL,
+      g_param_spec_uint ("landmark-interval", "Landmark interval",
+          "Sets the maximum number of frames between two predictions of the "
+          "landmark of a face. In between, the landmark follows the face "
+          "with optical flow, and it is predicted again as soon as the flow "
+          "is not reliable or the face changes too much. 1 predicts it on "
+          "every frame.",
+          1, G_MAXUINT, DEFAULT_LANDMARK_INTERVAL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_LOCAL_REDETECT,
+      g_param_spec_boolean ("local-redetect", "Local redetect",
+          "Sets whether to detect the face of a weak track again only "
+          "around it, a track being weak when its tracker lost the target or "
+          "is less confident than min-confidence. A face found there starts "
+          "its tracker again, otherwise it coasts and only forces a "
+          "detection phase once coast-duration is over.",
+          DEFAULT_LOCAL_REDETECT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MIN_CONFIDENCE,
+      g_param_spec_double ("min-confidence", "Minimum confidence",
+          "Sets the confidence of a tracker, from 0 to 1, below which its "
+          "face is detected again around it when local-redetect is set. "
+          "OpenCV trackers are either fully confident or lost.",
+          0.0, 1.0, DEFAULT_MIN_CONFIDENCE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_ASYNC_DETECTION,
+      g_param_spec_boolean ("async-detection", "Asynchronous detection",
+          "Sets whether to run the detection phases on a background thread, "
+          "on a snapshot of the frame, while the trackers keep going. The "
+          "trackers of the faces found catch up with the stream by replaying "
+          "the frames since the snapshot, so no frame waits for the "
+          "detector.",
+          DEFAULT_ASYNC_DETECTION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_SLICES,
+      g_param_spec_uint ("detection-slices", "Detection slices",
+          "Sets the number of slices a detection phase is split in. Each "
+          "slice scans the whole frame at a group of scales of the image "
+          "pyramid, one slice per frame, so the frames share the cost of the "
+          "detection. The faces found are those of a detection in one go, "
+          "given to the tracks once every slice is scanned and moved along "
+          "with the faces they are the nearest to. Neither the motion gate "
+          "nor the tiles are used. 1 scans the whole frame at once. Ignored "
+          "with async-detection.",
+          1, 64, DEFAULT_DETECTION_SLICES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
 
   gst_element_class_set_details_simple (gstelement_class,
@@ -328,14 +596,52 @@ gst_cheese_face_track_init (GstCheeseFaceTrack * filter)
   filter->landmark = NULL;
   filter->tracker_type = DEFAULT_TRACKER;
   filter->detection_gap_duration = DEFAULT_DETECTION_GAP_DURATION;
-  filter->face_detector =
-      new frontal_face_detector (get_frontal_face_detector());
+  filter->max_threads = DEFAULT_MAX_THREADS;
+  filter->tile_size = DEFAULT_TILE_SIZE;
+  filter->tile_overlap = DEFAULT_TILE_OVERLAP;
+  filter->motion_threshold = DEFAULT_MOTION_THRESHOLD;
+  filter->motion_gate = new CheeseMotionGate ();
+  filter->luma_scaler = new CheeseLumaScaler ();
+  filter->scratch_pool = new CheeseScratchPool ();
+  filter->arena = new CheeseArena ();
+  filter->assignment = new CheeseGatedAssignment ();
+  filter->static_threshold = DEFAULT_STATIC_THRESHOLD;
+  filter->scene_cut_threshold = DEFAULT_SCENE_CUT_THRESHOLD;
+  filter->coast_duration = DEFAULT_COAST_DURATION;
+  filter->compensate_camera_motion = DEFAULT_COMPENSATE_CAMERA_MOTION;
+  filter->camera_motion = new CheeseCameraMotion ();
+  filter->landmark_interval = DEFAULT_LANDMARK_INTERVAL;
+  filter->local_redetect = DEFAULT_LOCAL_REDETECT;
+  filter->min_confidence = DEFAULT_MIN_CONFIDENCE;
+  filter->async_detection = DEFAULT_ASYNC_DETECTION;
+  filter->detection_slices = DEFAULT_DETECTION_SLICES;
+  filter->flow_pyramid = new CheeseFlowPyramid ();
+  filter->tracker_pool = new CheeseTrackerPool ();
+  filter->scene_change = new CheeseSceneChange ();
+  filter->accumulated_change = 0.0;
+  filter->face_detector = new CheeseFaceDetector ();
   filter->shape_predictor = NULL;
   filter->scale_factor = DEFAULT_SCALE_FACTOR;
   filter->distance_factor = DEFAULT_DISTANCE_FACTOR;
 
   filter->faces = new std::map<guint, CheeseFace>;
 
+  g_mutex_init (&filter->async_lock);
+  g_cond_init (&filter->async_cond);
+  filter->async_thread = NULL;
+  filter->async_stop = FALSE;
+  filter->async_job = NULL;
+  filter->async_detector = new CheeseFaceDetector ();
+  filter->async_motion_gate = new CheeseMotionGate ();
+  filter->async_frames = new std::vector<cv::Mat>;
+  filter->async_n_frames = 0;
+  filter->async_pyramid = new CheeseFlowPyramid ();
+
+  filter->sweep_running = FALSE;
+  filter->sweep_slice = 0;
+  filter->sweep_n_slices = 0;
+  filter->sweep_dets = new std::vector<CheeseFaceTrackSweepDet>;
+
   gst_opencv_video_filter_set_in_place (GST_OPENCV_VIDEO_FILTER_CAST (filter),
       TRUE);
 }
@@ -390,6 +696,49 @@ gst_cheese_face_track_set_property (GObject * object, guint prop_id,
     case PROP_DETECTION_GAP_DURATION:
       filter->detection_gap_duration = g_value_get_uint (value);
       break;
+    case PROP_MAX_THREADS:
+      filter->max_threads = g_value_get_uint (value);
+      break;
+    case PROP_TILE_SIZE:
+      /* A tile smaller than the detection window never holds a face. */
+      filter->tile_size = g_value_get_uint (value);
+      if (filter->tile_size > 0)
+        filter->tile_size = MAX (filter->tile_size,
+            CHEESE_FACE_DETECTOR_WINDOW_SIZE);
+      break;
+    case PROP_TILE_OVERLAP:
+      filter->tile_overlap = g_value_get_uint (value);
+      break;
+    case PROP_MOTION_THRESHOLD:
+      filter->motion_threshold = g_value_get_double (value);
+      break;
+    case PROP_STATIC_THRESHOLD:
+      filter->static_threshold = g_value_get_double (value);
+      break;
+    case PROP_SCENE_CUT_THRESHOLD:
+      filter->scene_cut_threshold = g_value_get_double (value);
+      break;
+    case PROP_COAST_DURATION:
+      filter->coast_duration = g_value_get_uint (value);
+      break;
+    case PROP_COMPENSATE_CAMERA_MOTION:
+      filter->compensate_camera_motion = g_value_get_boolean (value);
+      break;
+    case PROP_LANDMARK_INTERVAL:
+      filter->landmark_interval = g_value_get_uint (value);
+      break;
+    case PROP_LOCAL_REDETECT:
+      filter->local_redetect = g_value_get_boolean (value);
+      break;
+    case PROP_MIN_CONFIDENCE:
+      filter->min_confidence = g_value_get_double (value);
+      break;
+    case PROP_ASYNC_DETECTION:
+      filter->async_detection = g_value_get_boolean (value);
+      break;
+    case PROP_DETECTION_SLICES:
+      filter->detection_slices = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -436,79 +785,253 @@ gst_cheese_face_track_get_property (GObject * object, guint prop_id,
     case PROP_DETECTION_GAP_DURATION:
       g_value_set_uint (value, filter->detection_gap_duration);
       break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, filter->max_threads);
+      break;
+    case PROP_TILE_SIZE:
+      g_value_set_uint (value, filter->tile_size);
+      break;
+    case PROP_TILE_OVERLAP:
+      g_value_set_uint (value, filter->tile_overlap);
+      break;
+    case PROP_MOTION_THRESHOLD:
+      g_value_set_double (value, filter->motion_threshold);
+      break;
+    case PROP_STATIC_THRESHOLD:
+      g_value_set_double (value, filter->static_threshold);
+      break;
+    case PROP_SCENE_CUT_THRESHOLD:
+      g_value_set_double (value, filter->scene_cut_threshold);
+      break;
+    case PROP_COAST_DURATION:
+      g_value_set_uint (value, filter->coast_duration);
+      break;
+    case PROP_COMPENSATE_CAMERA_MOTION:
+      g_value_set_boolean (value, filter->compensate_camera_motion);
+      break;
+    case PROP_LANDMARK_INTERVAL:
+      g_value_set_uint (value, filter->landmark_interval);
+      break;
+    case PROP_LOCAL_REDETECT:
+      g_value_set_boolean (value, filter->local_redetect);
+      break;
+    case PROP_MIN_CONFIDENCE:
+      g_value_set_double (value, filter->min_confidence);
+      break;
+    case PROP_ASYNC_DETECTION:
+      g_value_set_boolean (value, filter->async_detection);
+      break;
+    case PROP_DETECTION_SLICES:
+      g_value_set_uint (value, filter->detection_slices);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/**
+ * Detection phases are scheduled every detection-gap-duration frames. When
+ * the change of the scene is measured, the scheduled ones are skipped while
+ * the scene stays static and one is forced as soon as the scene cuts.
+ **/
 static gboolean
-gst_cheese_face_track_is_detection_phase (GstCheeseFaceTrack * filter)
+gst_cheese_face_track_is_detection_phase (GstCheeseFaceTrack * filter,
+    cv::Mat & img)
+{
+  gboolean scheduled =
+      filter->frame_number % filter->detection_gap_duration == 1;
+  gdouble change;
+
+  if (filter->static_threshold == 0.0 && filter->scene_cut_threshold == 0.0) {
+    filter->scene_change->reset ();
+    return scheduled;
+  }
+
+  change = filter->scene_change->update (img);
+  filter->accumulated_change += change;
+  GST_LOG ("Scene change: %.2f, %.2f since the last detection phase.",
+      change, filter->accumulated_change);
+
+  if (filter->scene_cut_threshold > 0.0 &&
+      change > filter->scene_cut_threshold) {
+    GST_LOG ("Detection phase was forced by a scene cut.");
+    return TRUE;
+  }
+  if (scheduled && filter->accumulated_change <= filter->static_threshold) {
+    GST_LOG ("Detection phase skipped, the scene is static.");
+    return FALSE;
+  }
+  return scheduled;
+}
+
+/**
+ * Moves all the faces along with the camera, one global estimate instead of
+ * every tracker searching on its own. The motion is estimated on every
+ * frame, even without faces, so it is ready when they appear.
+ **/
+static void
+gst_cheese_face_track_follow_camera (GstCheeseFaceTrack * filter,
+    cv::Mat & img)
 {
-  return filter->frame_number % filter->detection_gap_duration == 1;
+  cv::Matx23d motion;
+
+  if (!filter->compensate_camera_motion) {
+    filter->camera_motion->reset ();
+    return;
+  }
+  if (!filter->camera_motion->estimate (img, motion)) {
+    GST_LOG ("Camera motion could not be estimated.");
+    return;
+  }
+
+  GST_LOG ("Camera motion: translation (%.1f, %.1f), %u inliers.",
+      motion (0, 2), motion (1, 2), filter->camera_motion->n_inliers);
+  for (auto &kv : *filter->faces)
+    kv.second.follow_camera (motion, CAMERA_MOTION_RESTART_FACTOR);
 }
 
 static void
 gst_cheese_face_track_try_scale_image (GstCheeseFaceTrack * filter,
     cv::Mat & img, cv::Mat & resized_img)
 {
-
-  if (filter->scale_factor != 1.0) {
-    cv::resize(img, resized_img, cv::Size (img.cols * filter->scale_factor,
-        img.rows * filter->scale_factor));
-    GST_LOG ("Image scaled by the factor %.2f. New image processing size: "
-        "%d (height) x %d (width).", filter->scale_factor,
-        resized_img.rows, resized_img.cols);
-  }
+  resized_img = filter->luma_scaler->scale (img, filter->scale_factor);
+  GST_LOG ("Image scaled by the factor %.2f. New image processing size: "
+      "%d (height) x %d (width).", filter->scale_factor,
+      resized_img.rows, resized_img.cols);
 }
 
 static void
-gst_cheese_face_track_detect_faces (GstCheeseFaceTrack * filter,
-    dlib::cv_image<bgr_pixel> & dlib_img, std::vector<dlib::rectangle> & dets)
+gst_cheese_face_track_get_detect_params (GstCheeseFaceTrack * filter,
+    CheeseFaceTrackDetectParams & params)
 {
-  dets = (*filter->face_detector) (dlib_img);
+  params.max_threads = filter->max_threads;
+  params.tile_size = filter->tile_size;
+  params.tile_overlap = filter->tile_overlap;
+  params.motion_threshold = filter->motion_threshold;
 }
 
-static std::vector<guint>
-gst_cheese_face_track_create_faces (GstCheeseFaceTrack * filter,
+/* Runs a detection phase with @detector and @motion_gate, the background
+ * detection has its own of both. Only @params is read, never the
+ * element. */
+static void
+gst_cheese_face_track_detect_faces (CheeseFaceDetector * detector,
+    CheeseMotionGate * motion_gate, const CheeseFaceTrackDetectParams & params,
     cv::Mat & img, std::vector<dlib::rectangle> & dets)
+{
+  detector->max_threads = params.max_threads;
+  if (params.motion_threshold > 0.0) {
+    motion_gate->threshold = params.motion_threshold;
+    dets = motion_gate->detect (*detector, img);
+    return;
+  }
+
+  /* The motion gate starts over whenever it is enabled again. */
+  motion_gate->reset ();
+  if (params.tile_size > 0)
+    dets = detector->detect_tiles (img, params.tile_size, params.tile_overlap);
+  else
+    dets = detector->detect (img);
+}
+
+static guint
+gst_cheese_face_track_create_face (GstCheeseFaceTrack * filter,
+    cv::Mat & img, dlib::rectangle & det)
 {
   GstCheeseFaceTrackClass *klass = GST_CHEESEFACETRACK_GET_CLASS (filter);
-  std::vector<guint> created_faces_ids;
-  guint i;
-  for (i = 0; i < dets.size(); i++) {
-    /**
-     * FIXME (Ineficient code)
-     * When we declare a new CheeseFace in this way we actually create a
-     * copy and this copy is obviously destructed after the end of this
-     * block/scope. A solution may be to use a constructor but I am not
-     * sure yet if CheeseFace should be a struct, a C++ class, a GObject...
-     **/
-    CheeseFace face_info;
-    face_info.set_last_detected_frame (filter->frame_number);
-    face_info.set_bounding_box (dets[i]);
-    face_info.free_user_data_func = klass->cheese_face_free_user_data_func;
-    /* Store face info in filter's dictionary. */
-    filter->last_face_id++;
-    (*filter->faces)[filter->last_face_id] = face_info;
-    /* Init tracker */
-    (*filter->faces)[filter->last_face_id].create_tracker (
-        filter->tracker_type);
-    (*filter->faces)[filter->last_face_id].init_tracker (img);
-
-    created_faces_ids.push_back (filter->last_face_id);
-
-    GST_LOG ("Face %d: this face has just been created.", filter->last_face_id);
-  };
-  return created_faces_ids;
+
+  /* Built in place in filter's dictionary, a face cannot be copied. */
+  filter->last_face_id++;
+  CheeseFace &face = (*filter->faces)[filter->last_face_id];
+  face.set_last_detected_frame (filter->frame_number);
+  face.set_bounding_box (det);
+  face.free_user_data_func = klass->cheese_face_free_user_data_func;
+  /* Init tracker */
+  face.create_tracker (filter->tracker_type, filter->tracker_pool);
+  face.init_tracker (img);
+
+  GST_LOG ("Face %d: this face has just been created.", filter->last_face_id);
+  return filter->last_face_id;
+}
+
+/**
+ * Searches the faces of the weak tracks, @weak indexes @faces, only around
+ * their boxes, all the windows in parallel. Each weak track takes the nearest
+ * face found in its window, starts its tracker again there and gets its entry
+ * of @found set.
+ **/
+static void
+gst_cheese_face_track_redetect_locally (GstCheeseFaceTrack * filter,
+    cv::Mat & img, cv::Mat & tracker_img, CheeseFace ** faces,
+    CheeseArenaVector<guint> & weak, gboolean * found)
+{
+  const cv::Rect bounds (0, 0, img.cols, img.rows);
+  CheeseArenaVector<guint> searched (filter->arena);
+  CheeseArenaVector<gboolean> taken (filter->arena);
+  std::vector<cv::Rect> windows;
+  std::vector<dlib::rectangle> dets;
+  guint i, j;
+
+  for (i = 0; i < weak.size (); i++) {
+    const cv::Rect2d box = faces[weak[i]]->bounding_box ();
+    const gdouble margin_x = box.width * LOCAL_REDETECT_MARGIN;
+    const gdouble margin_y = box.height * LOCAL_REDETECT_MARGIN;
+    cv::Rect window = cv::Rect (box.x - margin_x, box.y - margin_y,
+        box.width + 2 * margin_x, box.height + 2 * margin_y) & bounds;
+
+    if (window.area () > 0) {
+      searched.push_back (weak[i]);
+      windows.push_back (window);
+    }
+  }
+  if (windows.empty ())
+    return;
+
+  filter->face_detector->max_threads = filter->max_threads;
+  dets = filter->face_detector->detect_regions (img, windows);
+  GST_LOG ("Local redetection: %d faces found around %d weak tracks.",
+      (gint) dets.size (), (gint) windows.size ());
+
+  taken.assign (dets.size (), FALSE);
+  for (i = 0; i < searched.size (); i++) {
+    CheeseFace *face = faces[searched[i]];
+    const cv::Point centroid = face->bounding_box_centroid ();
+    gdouble best_distance = G_MAXDOUBLE;
+    gint best = -1;
+
+    for (j = 0; j < dets.size (); j++) {
+      cv::Rect2d rect;
+      cv::Point det_centroid;
+
+      if (taken[j])
+        continue;
+      dlib_rectangle_to_cv_rect (dets[j], rect);
+      det_centroid = (rect.tl () + rect.br ()) * 0.5;
+      if (windows[i].contains (det_centroid) &&
+          cv::norm (det_centroid - centroid) < best_distance) {
+        best_distance = cv::norm (det_centroid - centroid);
+        best = j;
+      }
+    }
+    if (best == -1)
+      continue;
+
+    taken[best] = TRUE;
+    face->set_bounding_box (dets[best]);
+    face->create_tracker (filter->tracker_type, filter->tracker_pool);
+    face->init_tracker (tracker_img);
+    found[searched[i]] =
+        face->state () == CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED;
+  }
 }
 
-static std::vector<cv::Point>
-get_centroids (std::vector<dlib::rectangle> & dets)
+static void
+get_centroids (std::vector<dlib::rectangle> & dets,
+    CheeseArenaVector<cv::Point> & centroids)
 {
   guint i;
-  std::vector<cv::Point> centroids;
 
+  centroids.reserve (dets.size ());
   for (i = 0; i < dets.size (); i++) {
     cv::Rect2d rect;
     cv::Point centroid;
@@ -516,7 +1039,463 @@ get_centroids (std::vector<dlib::rectangle> & dets)
     centroid = (rect.tl () + rect.br ()) * 0.5;
     centroids.push_back(centroid);
   }
-  return centroids;
+}
+
+/**
+ * Pairs the detections @dets with the @n_faces faces @ids, at @centroids,
+ * each taking only the detections within its radius of @radii. The
+ * detections left are still paired with the faces left, without any limit.
+ * Those faces are too far from the detector, so their drifted trackers are
+ * released and started again on the detection. @assignment gets, for each
+ * detection, the index in @ids of the face taking it or -1 for a new face.
+ **/
+static void
+gst_cheese_face_track_assign_detections (GstCheeseFaceTrack * filter,
+    std::vector<dlib::rectangle> & dets, const guint * ids,
+    const cv::Point * centroids, const gfloat * radii, guint n_faces,
+    CheeseArenaVector<gint> & assignment)
+{
+  CheeseGatedAssignment *solver = filter->assignment;
+  CheeseArenaVector<cv::Point> detection_centroids (filter->arena);
+  CheeseArenaVector<gfloat> detection_radii (filter->arena);
+  CheeseArenaVector<gboolean> far (filter->arena);
+  guint i;
+
+  assignment.assign (dets.size (), -1);
+  if (n_faces == 0 || dets.empty ())
+    return;
+
+  get_centroids (dets, detection_centroids);
+  detection_radii.reserve (dets.size ());
+  for (i = 0; i < dets.size (); i++)
+    detection_radii.push_back (filter->distance_factor * dets[i].width ());
+
+  /* Solve the Hungarian problem, only between neighbours. */
+  GST_LOG ("Hungarian method: solve the Hungarian problem of "
+      "detected faces x filter's faces excluding just created: "
+      "%d rows x %d cols", (gint) dets.size (), (gint) n_faces);
+  far.resize (dets.size ());
+  solver->solve_far (detection_centroids.data (), detection_radii.data (),
+      dets.size (), centroids, radii, n_faces, assignment.data (),
+      far.data ());
+  GST_LOG ("Hungarian method: %u pairs close enough in %u groups.",
+      solver->n_pairs, solver->n_components);
+
+  for (i = 0; i < dets.size (); i++) {
+    if (far[i]) {
+      const guint id = ids[assignment[i]];
+      std::map<guint, CheeseFace>::iterator it = filter->faces->find (id);
+
+      GST_LOG ("Face %d: this face is too far from detector", id);
+      if (it != filter->faces->end ())
+        it->second.release_tracker ();
+    }
+  }
+}
+
+/**
+ * Does what gst_cheese_face_track_assign_detections () decided on @img: the
+ * faces whose tracker lost its target take their detection and a face is
+ * created for each new one. The faces whose tracker starts are added to
+ * @started and the face of each detection to @detected, NULL if it was
+ * removed meanwhile, if given.
+ **/
+static void
+gst_cheese_face_track_apply_detections (GstCheeseFaceTrack * filter,
+    std::vector<dlib::rectangle> & dets, const guint * ids,
+    CheeseArenaVector<gint> & assignment, cv::Mat & img,
+    CheeseArenaVector<CheeseFace *> * started,
+    CheeseArenaVector<CheeseFace *> * detected)
+{
+  guint i, id;
+
+  for (i = 0; i < assignment.size (); i++) {
+    if (assignment[i] == -1) {
+      /* Assume a new face was found. Create a new face. */
+      GST_LOG ("Face detector at index %d could not be assigned.", i);
+      id = gst_cheese_face_track_create_face (filter, img, dets[i]);
+      if (started)
+        started->push_back (&(*filter->faces)[id]);
+      if (detected)
+        detected->push_back (&(*filter->faces)[id]);
+    } else {
+      std::map<guint, CheeseFace>::iterator it;
+
+      id = ids[assignment[i]];
+      it = filter->faces->find (id);
+      /* Removed since a background detection started. */
+      if (it == filter->faces->end ()) {
+        if (detected)
+          detected->push_back (NULL);
+        continue;
+      }
+      CheeseFace &face = it->second;
+      if (detected)
+        detected->push_back (&face);
+      /* Create a new tracker if the target was lost. */
+      if (face.state () == CHEESE_FACE_INFO_STATE_TRACKER_UNSET) {
+        GST_LOG ("Face %d: creating a new tracker because target was lost.",
+            id);
+        face.set_bounding_box (dets[i]);
+        face.create_tracker (filter->tracker_type, filter->tracker_pool);
+        face.init_tracker (img);
+        face.set_last_detected_frame (filter->frame_number);
+        if (started)
+          started->push_back (&face);
+      }
+    }
+  }
+}
+
+/**
+ * Gives the detections of a detection phase to the faces where they are now
+ * and starts the trackers on @img.
+ **/
+static void
+gst_cheese_face_track_take_detections (GstCheeseFaceTrack * filter,
+    std::vector<dlib::rectangle> & dets, cv::Mat & img)
+{
+  CheeseArenaVector<guint> ids (filter->arena);
+  CheeseArenaVector<cv::Point> centroids (filter->arena);
+  CheeseArenaVector<gfloat> radii (filter->arena);
+  CheeseArenaVector<gint> assignment (filter->arena);
+
+  /* The faces only take the detections their motion predicts. */
+  ids.reserve (filter->faces->size ());
+  centroids.reserve (filter->faces->size ());
+  radii.reserve (filter->faces->size ());
+  for (auto &kv : *filter->faces) {
+    ids.push_back (kv.first);
+    centroids.push_back (kv.second.bounding_box_centroid ());
+    radii.push_back (MIN (kv.second.motion_gate_radius (), G_MAXFLOAT));
+  }
+  gst_cheese_face_track_assign_detections (filter, dets, ids.data (),
+      centroids.data (), radii.data (), ids.size (), assignment);
+  gst_cheese_face_track_apply_detections (filter, dets, ids.data (),
+      assignment, img, NULL, NULL);
+}
+
+/* Keeps the hits of a slice with the face each one is the nearest to,
+ * within the gate of the face, on the frame the slice was scanned. */
+static void
+gst_cheese_face_track_keep_slice (GstCheeseFaceTrack * filter,
+    std::vector<dlib::rect_detection> & hits)
+{
+  guint i;
+
+  for (i = 0; i < hits.size (); i++) {
+    CheeseFaceTrackSweepDet sweep_det;
+    cv::Rect2d rect;
+    cv::Point centroid;
+    gdouble best_distance = G_MAXDOUBLE;
+
+    dlib_rectangle_to_cv_rect (hits[i].rect, rect);
+    centroid = (rect.tl () + rect.br ()) * 0.5;
+    sweep_det.hit = hits[i];
+    sweep_det.has_face = FALSE;
+    for (auto &kv : *filter->faces) {
+      const cv::Point face_centroid = kv.second.bounding_box_centroid ();
+      const gdouble distance = cv::norm (face_centroid - centroid);
+
+      if (distance < kv.second.motion_gate_radius () &&
+          distance < best_distance) {
+        best_distance = distance;
+        sweep_det.has_face = TRUE;
+        sweep_det.face_id = kv.first;
+        sweep_det.face_centroid = face_centroid;
+      }
+    }
+    filter->sweep_dets->push_back (sweep_det);
+  }
+}
+
+/**
+ * Spreads a detection phase over detection-slices frames, scanning the whole
+ * frame at one group of pyramid levels on each. The hits are kept until
+ * every level is scanned, each one moved as much as its face moved since its
+ * slice was scanned, and only then merged into the detections given to the
+ * faces. @wanted starts a sweep if none is running and @dets gets the
+ * detections of the sweep once it is over.
+ **/
+static void
+gst_cheese_face_track_detect_sliced (GstCheeseFaceTrack * filter,
+    cv::Mat & img, cv::Mat & tracker_img, gboolean wanted,
+    std::vector<dlib::rectangle> & dets)
+{
+  std::vector<dlib::rect_detection> hits;
+  guint i;
+
+  if (!filter->sweep_running) {
+    if (!wanted)
+      return;
+    filter->sweep_running = TRUE;
+    filter->sweep_slice = 0;
+    filter->sweep_n_slices = filter->detection_slices;
+    filter->sweep_dets->clear ();
+    filter->accumulated_change = 0.0;
+    /* The motion gate starts over whenever it is enabled again. */
+    filter->motion_gate->reset ();
+    GST_LOG ("Detection sweep in %u slices.", filter->sweep_n_slices);
+  }
+
+  filter->face_detector->max_threads = filter->max_threads;
+  filter->face_detector->detect_slice (img, filter->sweep_slice,
+      filter->sweep_n_slices, hits);
+  gst_cheese_face_track_keep_slice (filter, hits);
+  GST_LOG ("Detection sweep: slice %u of %u, %d hits.",
+      filter->sweep_slice + 1, filter->sweep_n_slices, (gint) hits.size ());
+  if (++filter->sweep_slice < filter->sweep_n_slices)
+    return;
+
+  filter->sweep_running = FALSE;
+  /* The slices were scanned on different frames, the hits catch up with
+   * the current one along with their faces. */
+  hits.clear ();
+  for (i = 0; i < filter->sweep_dets->size (); i++) {
+    CheeseFaceTrackSweepDet & sweep_det = (*filter->sweep_dets)[i];
+    dlib::rect_detection hit = sweep_det.hit;
+
+    if (sweep_det.has_face) {
+      std::map<guint, CheeseFace>::iterator it =
+          filter->faces->find (sweep_det.face_id);
+
+      if (it != filter->faces->end ()) {
+        const cv::Point shift =
+            it->second.bounding_box_centroid () - sweep_det.face_centroid;
+        hit.rect = dlib::translate_rect (hit.rect, shift.x, shift.y);
+      }
+    }
+    hits.push_back (hit);
+  }
+  filter->sweep_dets->clear ();
+  dets = filter->face_detector->suppress (hits);
+  gst_cheese_face_track_take_detections (filter, dets, tracker_img);
+}
+
+static gpointer
+gst_cheese_face_track_async_loop (gpointer user_data)
+{
+  GstCheeseFaceTrack *filter = GST_CHEESEFACETRACK (user_data);
+
+  g_mutex_lock (&filter->async_lock);
+  while (TRUE) {
+    CheeseFaceTrackDetectJob *job;
+
+    while (!filter->async_stop &&
+        (!filter->async_job || filter->async_job->done))
+      g_cond_wait (&filter->async_cond, &filter->async_lock);
+    if (filter->async_stop)
+      break;
+    /* The streaming thread leaves the job alone until it is done. */
+    job = filter->async_job;
+    g_mutex_unlock (&filter->async_lock);
+
+    gst_cheese_face_track_detect_faces (filter->async_detector,
+        filter->async_motion_gate, job->params, job->frame, job->dets);
+
+    g_mutex_lock (&filter->async_lock);
+    job->done = TRUE;
+    GST_LOG ("Background detection finished.");
+  }
+  g_mutex_unlock (&filter->async_lock);
+
+  return NULL;
+}
+
+static void
+gst_cheese_face_track_async_stop (GstCheeseFaceTrack * filter)
+{
+  g_mutex_lock (&filter->async_lock);
+  if (filter->async_thread) {
+    GThread *thread = filter->async_thread;
+
+    filter->async_stop = TRUE;
+    g_cond_signal (&filter->async_cond);
+    g_mutex_unlock (&filter->async_lock);
+    g_thread_join (thread);
+    g_mutex_lock (&filter->async_lock);
+    filter->async_thread = NULL;
+    filter->async_stop = FALSE;
+    /* The thread is gone, its gate starts over with the next one. */
+    filter->async_motion_gate->reset ();
+  }
+  if (filter->async_job) {
+    delete filter->async_job;
+    filter->async_job = NULL;
+  }
+  g_mutex_unlock (&filter->async_lock);
+  filter->async_n_frames = 0;
+}
+
+/* Keeps a tracker frame for the trackers started on the snapshot of @job,
+ * up to ASYNC_MAX_CATCHUP_FRAMES. The memory of the frames is reused. */
+static void
+gst_cheese_face_track_keep_frame (GstCheeseFaceTrack * filter,
+    CheeseFaceTrackDetectJob * job, cv::Mat & tracker_img)
+{
+  std::vector<cv::Mat> & frames = *filter->async_frames;
+
+  if (filter->async_n_frames == ASYNC_MAX_CATCHUP_FRAMES) {
+    job->stale = TRUE;
+    return;
+  }
+  if (filter->async_n_frames < frames.size ())
+    tracker_img.copyTo (frames[filter->async_n_frames]);
+  else
+    frames.push_back (tracker_img.clone ());
+  filter->async_n_frames++;
+}
+
+/**
+ * Replays the frames kept since the snapshot on the trackers of @faces,
+ * started on the snapshot, so they reach the current frame. At most
+ * ASYNC_MAX_REPLAY_FRAMES frames are replayed, evenly spaced and ending on
+ * the current one, so a slow detection does not make the frame that takes it
+ * slow in turn. The faces are updated in parallel on each frame, sharing its
+ * pyramids. A face whose tracker loses its target is released, as on any
+ * frame, and not replayed any further.
+ **/
+static void
+gst_cheese_face_track_catch_up (GstCheeseFaceTrack * filter,
+    CheeseArenaVector<CheeseFace *> & started)
+{
+  std::vector<cv::Mat> & frames = *filter->async_frames;
+  const guint n_frames = filter->async_n_frames;
+  const gboolean shared =
+      filter->tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW;
+  CheeseFlowPyramid *pyramid = shared ? filter->async_pyramid : NULL;
+  CheeseArenaVector<CheeseFace *> faces (started);
+  CheeseArenaVector<gboolean> found (filter->arena);
+  guint n_replayed, i, j, n_tracked;
+
+  if (faces.empty () || n_frames < 2)
+    return;
+
+  found.resize (faces.size ());
+  n_replayed = MIN (n_frames - 1, ASYNC_MAX_REPLAY_FRAMES);
+  if (pyramid) {
+    pyramid->reset ();
+    pyramid->update (frames[0]);
+  }
+  for (i = 1; i <= n_replayed && !faces.empty (); i++) {
+    cv::Mat & frame = frames[i * (n_frames - 1) / n_replayed];
+
+    if (pyramid)
+      pyramid->update (frame);
+    cheese_faces_update_trackers (faces.data (), faces.size (), frame,
+        pyramid, filter->max_threads, found.data ());
+    /* update_tracker () released the trackers that lost their target. */
+    n_tracked = 0;
+    for (j = 0; j < faces.size (); j++) {
+      if (found[j])
+        faces[n_tracked++] = faces[j];
+    }
+    faces.resize (n_tracked);
+  }
+}
+
+/**
+ * Runs the detection phases on a background thread, on a snapshot of the
+ * frame, while the trackers keep going. Once the detections are back they
+ * are assigned to the faces where they were at the snapshot, the trackers
+ * they start are started on the snapshot and catch up with the stream by
+ * replaying the frames kept since. @wanted starts a detection if none is
+ * running and @dets gets the detections applied on this frame, if any.
+ **/
+static void
+gst_cheese_face_track_detect_async (GstCheeseFaceTrack * filter,
+    cv::Mat & img, cv::Mat & tracker_img, gboolean wanted,
+    std::vector<dlib::rectangle> & dets)
+{
+  CheeseFaceTrackDetectJob *job = filter->async_job;
+  gboolean done;
+
+  if (job) {
+    gst_cheese_face_track_keep_frame (filter, job, tracker_img);
+    g_mutex_lock (&filter->async_lock);
+    done = job->done;
+    g_mutex_unlock (&filter->async_lock);
+    if (!done)
+      return;
+
+    if (job->stale) {
+      GST_LOG ("Background detection dropped, too old to catch up with.");
+    } else {
+      CheeseArenaVector<gint> assignment (filter->arena);
+      CheeseArenaVector<CheeseFace *> started (filter->arena);
+      CheeseArenaVector<CheeseFace *> detected (filter->arena);
+      guint i;
+
+      GST_LOG ("Background detection of frame %u applied, %u frames to "
+          "catch up with.", job->frame_number, filter->async_n_frames - 1);
+      gst_cheese_face_track_assign_detections (filter, job->dets,
+          job->face_ids.data (), job->face_centroids.data (),
+          job->face_radii.data (), job->face_ids.size (), assignment);
+      gst_cheese_face_track_apply_detections (filter, job->dets,
+          job->face_ids.data (), assignment, (*filter->async_frames)[0],
+          &started, &detected);
+      /* Detected on the snapshot, only those still tracked once they
+       * caught up are detected on this frame. The others coast from the
+       * snapshot, waiting for a local redetection or the next detection
+       * phase. */
+      for (i = 0; i < started.size (); i++)
+        started[i]->set_last_detected_frame (job->frame_number);
+      gst_cheese_face_track_catch_up (filter, started);
+      for (i = 0; i < started.size (); i++) {
+        if (started[i]->state () != CHEESE_FACE_INFO_STATE_TRACKER_UNSET)
+          started[i]->set_last_detected_frame (filter->frame_number);
+      }
+      /* The detections are shown where their faces are now, not where they
+       * were found on the snapshot, and not at all for a lost face. */
+      for (i = 0; i < detected.size (); i++) {
+        cv::Rect2d box;
+        dlib::rectangle rect;
+
+        if (!detected[i] ||
+            detected[i]->state () == CHEESE_FACE_INFO_STATE_TRACKER_UNSET)
+          continue;
+        box = detected[i]->bounding_box ();
+        cv_rect_to_dlib_rectangle (box, rect);
+        dets.push_back (rect);
+      }
+    }
+
+    g_mutex_lock (&filter->async_lock);
+    filter->async_job = NULL;
+    g_mutex_unlock (&filter->async_lock);
+    delete job;
+    filter->async_n_frames = 0;
+  }
+
+  if (!wanted)
+    return;
+
+  /* Where the faces are at the snapshot, for the detections to be
+   * assigned to. */
+  job = new CheeseFaceTrackDetectJob;
+  img.copyTo (job->frame);
+  job->frame_number = filter->frame_number;
+  gst_cheese_face_track_get_detect_params (filter, job->params);
+  job->done = FALSE;
+  job->stale = FALSE;
+  for (auto &kv : *filter->faces) {
+    job->face_ids.push_back (kv.first);
+    job->face_centroids.push_back (kv.second.bounding_box_centroid ());
+    job->face_radii.push_back (
+        MIN (kv.second.motion_gate_radius (), G_MAXFLOAT));
+  }
+  gst_cheese_face_track_keep_frame (filter, job, tracker_img);
+  filter->accumulated_change = 0.0;
+
+  g_mutex_lock (&filter->async_lock);
+  if (!filter->async_thread)
+    filter->async_thread = g_thread_new ("cheesefacetrack",
+        gst_cheese_face_track_async_loop, filter);
+  filter->async_job = job;
+  g_cond_signal (&filter->async_cond);
+  g_mutex_unlock (&filter->async_lock);
+  GST_LOG ("Frame %u handed to the background detection.",
+      filter->frame_number);
 }
 
 gboolean
@@ -526,10 +1505,10 @@ gst_cheese_face_track_display_face (GstCheeseFaceTrack * filter,
   return face.last_detected_frame () == filter->frame_number;
 }
 
-static std::vector<guint>
-gst_cheese_face_track_try_to_remove_faces (GstCheeseFaceTrack * filter)
+static void
+gst_cheese_face_track_try_to_remove_faces (GstCheeseFaceTrack * filter,
+    CheeseArenaVector<guint> & to_remove)
 {
-  std::vector<guint> to_remove;
   for (auto &kv : *filter->faces) {
     guint delta_since_detected;
     guint id = kv.first;
@@ -546,8 +1525,81 @@ gst_cheese_face_track_try_to_remove_faces (GstCheeseFaceTrack * filter)
       to_remove.push_back (id);
     }
   }
+}
+
+struct CheeseFaceTrackLandmarkBatch {
+  GstCheeseFaceTrack *filter;
+  cv::Mat *img;
+  /* Whether landmarks may follow the optical flow. */
+  gboolean flow;
+  CheeseArenaVector<CheeseFace *> faces;
+
+  CheeseFaceTrackLandmarkBatch (CheeseArena * arena) : faces (arena) {}
+};
+
+/* Moves the landmark of a single face with the optical flow, or runs the
+ * shape predictor on it when it is due or the flow fails. Only the face of
+ * the task is written, so tasks can run in any order. */
+static void
+gst_cheese_face_track_landmark_task (guint index, gpointer user_data)
+{
+  CheeseFaceTrackLandmarkBatch *batch =
+      (CheeseFaceTrackLandmarkBatch *) user_data;
+  GstCheeseFaceTrack *filter = batch->filter;
+  CheeseFace *face = batch->faces[index];
+  /* Written in place, it keeps its capacity from frame to frame. */
+  std::vector<cv::Point> & landmark = face->landmark ();
+  cv::Rect2d resized_bounding_box, previous_bounding_box;
+  dlib::rectangle dlib_resized_bounding_box;
+  dlib::full_object_detection shape;
+  guint i;
+
+  resized_bounding_box = face->bounding_box ();
+  previous_bounding_box = face->landmark_bounding_box;
+  face->landmark_bounding_box = resized_bounding_box;
+  /* The flow needs the landmark of the previous frame. */
+  if (batch->flow && face->landmark_frame + 1 == filter->frame_number &&
+      filter->frame_number - face->landmark_predicted_frame <
+          filter->landmark_interval &&
+      cheese_landmark_flow_propagate (*filter->flow_pyramid, landmark,
+          previous_bounding_box, resized_bounding_box)) {
+    face->landmark_frame = filter->frame_number;
+    return;
+  }
 
-  return to_remove;
+  cv_rect_to_dlib_rectangle (resized_bounding_box, dlib_resized_bounding_box);
+  shape = cheese_shape_predict (*filter->shape_predictor, *batch->img,
+      dlib_resized_bounding_box);
+  face->landmark_predicted_frame = filter->frame_number;
+  face->landmark_frame = filter->frame_number;
+
+  landmark.clear ();
+  for (i = 0; i < shape.num_parts (); i++)
+    landmark.push_back (cv::Point (shape.part (i).x (), shape.part (i).y ()));
+}
+
+static gboolean
+gst_cheese_face_track_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstCheeseFaceTrack *filter = GST_CHEESEFACETRACK (vfilter);
+  CheeseScratchPool *pool = filter->scratch_pool;
+
+  if (!cheese_video_frame_set_info (vfilter, in_info, pool))
+    return FALSE;
+  /* Reserved whatever the tracker, its type may change while streaming. */
+  pool->reserve (TRACK_SCRATCH_TRACKER, CV_8UC3);
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_cheese_face_track_transform_frame_ip (GstVideoFilter * vfilter,
+    GstVideoFrame * frame)
+{
+  GstCheeseFaceTrack *filter = GST_CHEESEFACETRACK (vfilter);
+
+  return cheese_video_frame_transform_frame_ip (vfilter, frame,
+      filter->scratch_pool);
 }
 
 static GstFlowReturn
@@ -555,26 +1607,42 @@ gst_cheese_face_track_transform_ip (GstOpencvVideoFilter * base,
     GstBuffer * buf, cv::Mat cv_img)
 {
   GstCheeseFaceTrack *filter = GST_CHEESEFACETRACK (base);
+  CheeseFaceTrackDetectParams params;
   GstCheeseMultifaceMeta *multiface_meta;
   /* Frame storage */
-  cv::Mat cv_resized_img (cv_img);
+  cv::Mat cv_resized_img;
+  cv::Mat cv_tracker_img;
   std::vector<dlib::rectangle> resized_dets;
-  dlib::cv_image<bgr_pixel> dlib_resized_img;
-  std::vector<guint> faces_ids_with_lost_target;
-  std::vector<guint> faces_ids_to_remove;
+  CheeseArenaVector<guint> faces_ids_with_lost_target (filter->arena);
+  CheeseArenaVector<guint> faces_ids_to_remove (filter->arena);
+  CheeseArenaVector<guint> weak_faces (filter->arena);
+  gboolean detection_phase;
   guint i;
 
-  gst_cheese_face_track_try_scale_image (filter, cv_img, cv_resized_img);
-  dlib_resized_img = cv_image<bgr_pixel> (cv_resized_img);
+  /* Nothing runs in the background without async-detection. */
+  if (!filter->async_detection)
+    gst_cheese_face_track_async_stop (filter);
 
-  std::vector<guint> non_created_faces_ids;
+  gst_cheese_face_track_try_scale_image (filter, cv_img, cv_resized_img);
+  /* GOTURN is the only tracker that needs a color frame. */
+  if (filter->tracker_type == GST_CHEESEFACETRACK_TRACKER_GOTURN &&
+      cv_resized_img.channels () == 1) {
+    cv_tracker_img = filter->scratch_pool->get (TRACK_SCRATCH_TRACKER,
+        cv_resized_img.size (), CV_8UC3);
+    cv::cvtColor (cv_resized_img, cv_tracker_img, cv::COLOR_GRAY2RGB);
+  } else
+    cv_tracker_img = cv_resized_img;
+
+  CheeseArenaVector<guint> non_created_faces_ids (filter->arena);
+  CheeseArenaVector<CheeseFace *> faces_to_track (filter->arena);
+  CheeseArenaVector<gboolean> targets_found (filter->arena);
 
   GST_DEBUG ("Frame number: %d.", filter->frame_number);
 
   multiface_meta = gst_buffer_add_cheese_multiface_meta (buf);
 
   /* If there are faces to remove add them to the metadata. */
-  faces_ids_to_remove = gst_cheese_face_track_try_to_remove_faces (filter);
+  gst_cheese_face_track_try_to_remove_faces (filter, faces_ids_to_remove);
   for (i = 0; i < faces_ids_to_remove.size (); i++) {
     filter->faces->erase (faces_ids_to_remove[i]);
     gst_cheese_multiface_meta_add_removed_face_id (multiface_meta,
@@ -583,113 +1651,85 @@ gst_cheese_face_track_transform_ip (GstOpencvVideoFilter * base,
         faces_ids_to_remove[i]);
   }
 
+  /* The pyramids are built on every frame, even without faces, so the
+   * previous one is always at hand. */
+  if (filter->tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW ||
+      (filter->shape_predictor && filter->landmark_interval > 1))
+    filter->flow_pyramid->update (cv_resized_img);
+  else
+    filter->flow_pyramid->reset ();
+
+  gst_cheese_face_track_follow_camera (filter, cv_resized_img);
+
+  /* Trackers of different faces are independent, update them in parallel. */
   for (auto &kv : *filter->faces) {
-    guint id = kv.first;
-    CheeseFace &face = kv.second;
-    if (face.update_tracker (cv_resized_img)) {
+    non_created_faces_ids.push_back (kv.first);
+    faces_to_track.push_back (&kv.second);
+  }
+  targets_found.resize (faces_to_track.size ());
+  cheese_faces_update_trackers (faces_to_track.data (), faces_to_track.size (),
+      cv_tracker_img, filter->flow_pyramid, filter->max_threads,
+      targets_found.data ());
+
+  /* There is a detection cycle in the case new faces enter to the scene. */
+  detection_phase =
+      gst_cheese_face_track_is_detection_phase (filter, cv_resized_img);
+
+  /* Weak tracks are searched around them first, a detection phase looks at
+   * the whole frame anyway. */
+  if (filter->local_redetect && !detection_phase) {
+    for (i = 0; i < faces_to_track.size (); i++) {
+      if (!targets_found[i] ||
+          faces_to_track[i]->confidence () < filter->min_confidence)
+        weak_faces.push_back (i);
+    }
+    if (!weak_faces.empty ())
+      gst_cheese_face_track_redetect_locally (filter, cv_resized_img,
+          cv_tracker_img, faces_to_track.data (), weak_faces,
+          targets_found.data ());
+  }
+
+  for (i = 0; i < non_created_faces_ids.size (); i++) {
+    const guint id = non_created_faces_ids[i];
+    /* A tracker started again where the camera moved the face measured
+     * nothing, it only waits like a coasting face does. */
+    if (targets_found[i] && !faces_to_track[i]->restarted ()) {
       GST_LOG ("Face %d: tracker updated.", id);
-      face.set_last_detected_frame (filter->frame_number);
+      faces_to_track[i]->set_last_detected_frame (filter->frame_number);
+    } else if (filter->frame_number - faces_to_track[i]->last_detected_frame ()
+        <= filter->coast_duration) {
+      /* Short occlusions wait for the next detection phase. */
+      GST_LOG ("Face %d: tracker has no target, following its motion.", id);
     } else {
       GST_LOG ("Face %d: tracker lost its target.", id);
       faces_ids_with_lost_target.push_back (id);
     }
-    non_created_faces_ids.push_back (id);
   }
 
-  /* There is a detection cycle in the case new faces enter to the scene. */
-  if (gst_cheese_face_track_is_detection_phase (filter) ||
-      faces_ids_with_lost_target.size () > 0) {
-    if (gst_cheese_face_track_is_detection_phase (filter))
+  if (filter->async_detection) {
+    gst_cheese_face_track_detect_async (filter, cv_resized_img, cv_tracker_img,
+        detection_phase || faces_ids_with_lost_target.size () > 0,
+        resized_dets);
+  } else if (filter->detection_slices > 1) {
+    gst_cheese_face_track_detect_sliced (filter, cv_resized_img,
+        cv_tracker_img, detection_phase ||
+        faces_ids_with_lost_target.size () > 0, resized_dets);
+  } else if (detection_phase || faces_ids_with_lost_target.size () > 0) {
+    filter->accumulated_change = 0.0;
+    if (detection_phase)
       GST_LOG ("Detection phase.");
     if (faces_ids_with_lost_target.size () > 0)
       GST_LOG ("Detection phase was forced because a tracker lost its target.");
 
-    gst_cheese_face_track_detect_faces (filter, dlib_resized_img, resized_dets);
-
-    /* Init faces, and thus create trackers */
-    if (filter->faces->empty ())
-      gst_cheese_face_track_create_faces (filter, cv_resized_img, resized_dets);
-
-    if (!non_created_faces_ids.empty () && resized_dets.size () > 0) {
-      guint r, c;
-      HungarianAlgorithm HungAlgo;
-      std::vector<int> assignment;
-      std::vector<std::vector<double>> cost_matrix;
-      std::vector<cv::Point> detection_centroids;
-
-      detection_centroids = get_centroids (resized_dets);
-
-      GST_LOG ("Hungarian method: initialize cost matrix of "
-          "detected faces x filter's faces excluding just created: "
-          "%d rows x %d cols",
-          (gint) detection_centroids.size (),
-          (gint) non_created_faces_ids.size ());
-
-      /* Initialize cost matrix. */
-      for (r = 0; r < detection_centroids.size (); r++) {
-        std::vector<double> row;
-        for (c = 0; c < non_created_faces_ids.size (); c++) {
-          const guint id = non_created_faces_ids[c];
-          CheeseFace &face = (*filter->faces)[id];
-          double dist;
-          dist = cv::norm (cv::Mat (detection_centroids[r]),
-              cv::Mat (face.bounding_box_centroid ()));
-          row.push_back (dist);
-        }
-        cost_matrix.push_back (row);
-      }
-
-      /* Solve the Hungarian problem */
-      GST_LOG ("Hungarian method: solve the Hungarian problem.");
-      HungAlgo.Solve(cost_matrix, assignment);
-
-      for (i = 0; i < cost_matrix.size (); i++) {
-        const gboolean asigned = assignment[i] != -1;
-        gboolean create_face;
-
-        /* Discard faces if they are too far. */
-        if (asigned) {
-          const gint id = non_created_faces_ids[assignment[i]];
-          CheeseFace &face = (*filter->faces)[id];
-          double max_dist;
-          double dist;
-
-          create_face = FALSE;
-
-          dist = cv::norm (cv::Mat (detection_centroids[i]),
-              cv::Mat ((*filter->faces)[id].bounding_box_centroid ()));
-          max_dist = filter->distance_factor * resized_dets[i].width ();
-
-          if (dist >= max_dist) {
-            GST_LOG ("Face %d: this face is too far from detector", id);
-            face.release_tracker ();
-          }
-        } else {
-          create_face = TRUE;
-        }
-
-        if (create_face) {
-          std::vector<dlib::rectangle> det_wrap;
-          det_wrap.push_back (resized_dets[i]);
-          /* Assume a new face was found. Create a new face. */
-          GST_LOG ("Face detector at index %d could not be assigned.", i);
-          gst_cheese_face_track_create_faces (filter, cv_resized_img, det_wrap);
-        } else {
-          const gint id = non_created_faces_ids[assignment[i]];
-          CheeseFace &face = (*filter->faces)[id];
-          /* Create a new tracker if the target was lost. */
-          if (face.state () == CHEESE_FACE_INFO_STATE_TRACKER_UNSET) {
-            GST_LOG ("Face %d: creating a new tracker because target was lost.",
-                id);
-            face.set_bounding_box (resized_dets[i]);
-            face.create_tracker (filter->tracker_type);
-            face.init_tracker (cv_resized_img);
-            face.set_last_detected_frame (filter->frame_number);
-          }
-        }
-      }
-    }
+    gst_cheese_face_track_get_detect_params (filter, params);
+    gst_cheese_face_track_detect_faces (filter->face_detector,
+        filter->motion_gate, params, cv_resized_img, resized_dets);
+    gst_cheese_face_track_take_detections (filter, resized_dets,
+        cv_tracker_img);
   }
+  /* A sweep does not survive a change of mode. */
+  if (filter->async_detection || filter->detection_slices <= 1)
+    filter->sweep_running = FALSE;
 
   if (filter->display_detection_phase && resized_dets.size () > 0) {
     guint i;
@@ -706,9 +1746,28 @@ gst_cheese_face_track_transform_ip (GstOpencvVideoFilter * base,
 
       centroid = (cv_rect.tl () + cv_rect.br ()) * 0.5;
       cv::putText (cv_img, std::to_string (i), centroid,
-          cv::FONT_HERSHEY_SIMPLEX, 1.0, DEFAULT_DETECTION_PHASE_COLOR);
-      cv::rectangle (cv_img, cv_rect, DEFAULT_DETECTION_PHASE_COLOR, 5);
+          cv::FONT_HERSHEY_SIMPLEX, 1.0,
+          cheese_video_frame_color (DEFAULT_DETECTION_PHASE_COLOR, cv_img));
+      cv::rectangle (cv_img, cv_rect,
+          cheese_video_frame_color (DEFAULT_DETECTION_PHASE_COLOR, cv_img), 5);
+    }
+  }
+
+  /* Set landmark. */
+  if (filter->shape_predictor) {
+    CheeseFaceTrackLandmarkBatch batch (filter->arena);
+
+    batch.filter = filter;
+    batch.img = &cv_resized_img;
+    batch.flow = filter->landmark_interval > 1;
+    for (auto &kv : *filter->faces) {
+      CheeseFace &face = kv.second;
+      if (face.state () == CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED ||
+          face.state () == CHEESE_FACE_INFO_STATE_TRACKER_WAITING)
+        batch.faces.push_back (&face);
     }
+    cheese_worker_pool_run (batch.faces.size (), filter->max_threads,
+        gst_cheese_face_track_landmark_task, &batch);
   }
 
   for (auto &kv : *filter->faces) {
@@ -733,30 +1792,16 @@ gst_cheese_face_track_transform_ip (GstOpencvVideoFilter * base,
           resized_bounding_box.height / filter->scale_factor);
       centroid = (bounding_box.tl () + bounding_box.br ()) * 0.5;
 
-      /* Set landmark. */
-      if (filter->shape_predictor) {
-        std::vector<cv::Point> landmark;
-        dlib::rectangle dlib_resized_bounding_box;
-        dlib::full_object_detection shape;
-
-        cv_rect_to_dlib_rectangle (resized_bounding_box,
-            dlib_resized_bounding_box);
-        shape = (*filter->shape_predictor)
-            (dlib_resized_img, dlib_resized_bounding_box);
-
-        if (filter->display_landmark)
-          GST_LOG ("Face %d: drawing landmark.", id);
-
-        for (i = 0; i < shape.num_parts (); i++) {
-          cv::Point resized_keypoint (shape.part (i).x (), shape.part (i).y ());
-          landmark.push_back (resized_keypoint);
-          /* Draw */
-          if (display && filter->display_landmark) {
-            cv::circle(cv_img, resized_keypoint / filter->scale_factor, 1,
-                DEFAULT_LANDMARK_COLOR, cv::FILLED);
-          }
+      /* Draw landmark. */
+      if (filter->shape_predictor && display && filter->display_landmark) {
+        std::vector<cv::Point> & landmark = face.landmark ();
+
+        GST_LOG ("Face %d: drawing landmark.", id);
+        for (i = 0; i < landmark.size (); i++) {
+          cv::circle(cv_img, landmark[i] / filter->scale_factor, 1,
+              cheese_video_frame_color (DEFAULT_LANDMARK_COLOR, cv_img),
+              cv::FILLED);
         }
-        face.set_landmark (landmark);
       }
 
       /* Draw */
@@ -767,18 +1812,19 @@ gst_cheese_face_track_transform_ip (GstOpencvVideoFilter * base,
             (int) bounding_box.width, (int) bounding_box.height);
         if (filter->display_bounding_box) {
           if (face.state () == CHEESE_FACE_INFO_STATE_TRACKER_INITIALIZED) {
-            cv::rectangle (cv_img, bounding_box,
-                DEFAULT_BOUNDING_BOX_DETECT_COLOR);
+            cv::rectangle (cv_img, bounding_box, cheese_video_frame_color (
+                DEFAULT_BOUNDING_BOX_DETECT_COLOR, cv_img));
           } else if (face.state () == CHEESE_FACE_INFO_STATE_TRACKER_WAITING) {
-            cv::rectangle (cv_img, bounding_box,
-                DEFAULT_BOUNDING_BOX_TRACK_COLOR);
+            cv::rectangle (cv_img, bounding_box, cheese_video_frame_color (
+                DEFAULT_BOUNDING_BOX_TRACK_COLOR, cv_img));
           }
         }
         if (filter->display_id) {
           GST_LOG ("Face %d: drawing id number. Position: (%d, %d).", id,
               (int) centroid.x, (int) centroid.y);
           cv::putText (cv_img, std::to_string (id), centroid,
-              cv::FONT_HERSHEY_SIMPLEX, 1.0, DEFAULT_ID_COLOR);
+              cv::FONT_HERSHEY_SIMPLEX, 1.0,
+              cheese_video_frame_color (DEFAULT_ID_COLOR, cv_img));
         }
       }
     }
@@ -788,17 +1834,66 @@ gst_cheese_face_track_transform_ip (GstOpencvVideoFilter * base,
     gst_cheese_multiface_info_insert (multiface_meta->faces, id, info);
   }
 
+  /* Spread the creation of the trackers the next frames may need. */
+  filter->tracker_pool->refill (filter->tracker_type);
+  /* Nothing allocated from the arena outlives the frame. */
+  filter->arena->reset ();
   filter->frame_number++;
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_cheese_face_track_stop (GstBaseTransform * trans)
+{
+  GstBaseTransformClass *bclass =
+      GST_BASE_TRANSFORM_CLASS (gst_cheese_face_track_parent_class);
+
+  gst_cheese_face_track_async_stop (GST_CHEESEFACETRACK (trans));
+
+  if (bclass->stop)
+    return bclass->stop (trans);
+  return TRUE;
+}
+
 static void
 gst_cheese_face_track_finalize (GObject * obj)
 {
   GstCheeseFaceTrack *filter = GST_CHEESEFACETRACK (obj);
 
+  gst_cheese_face_track_async_stop (filter);
+  g_mutex_clear (&filter->async_lock);
+  g_cond_clear (&filter->async_cond);
+  if (filter->async_detector)
+    delete filter->async_detector;
+  if (filter->async_motion_gate)
+    delete filter->async_motion_gate;
+  if (filter->async_frames)
+    delete filter->async_frames;
+  if (filter->async_pyramid)
+    delete filter->async_pyramid;
+  if (filter->sweep_dets)
+    delete filter->sweep_dets;
+
   if (filter->face_detector)
     delete filter->face_detector;
+  if (filter->motion_gate)
+    delete filter->motion_gate;
+  if (filter->luma_scaler)
+    delete filter->luma_scaler;
+  if (filter->scratch_pool)
+    delete filter->scratch_pool;
+  if (filter->arena)
+    delete filter->arena;
+  if (filter->assignment)
+    delete filter->assignment;
+  if (filter->scene_change)
+    delete filter->scene_change;
+  if (filter->camera_motion)
+    delete filter->camera_motion;
+  if (filter->flow_pyramid)
+    delete filter->flow_pyramid;
+  if (filter->tracker_pool)
+    delete filter->tracker_pool;
   if (filter->shape_predictor)
     delete filter->shape_predictor;
 
@@ -59,8 +59,6 @@
 #include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/image_processing.h>
 
-#include "Hungarian.h"
-
 G_BEGIN_DECLS
 
 /* #defines don't like whitespacey bits */
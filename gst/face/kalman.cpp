@@ -0,0 +1,192 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "kalman.h"
+
+CheeseKalmanBox::CheeseKalmanBox ()
+{
+  _initialized = FALSE;
+}
+
+gboolean
+CheeseKalmanBox::initialized ()
+{
+  return _initialized;
+}
+
+/* Starts at @box, standing still but with an uncertain velocity. */
+void
+CheeseKalmanBox::init (const cv::Rect2d & box)
+{
+  const gdouble r = CHEESE_KALMAN_MEASUREMENT_NOISE * box.width;
+  const gdouble v = CHEESE_KALMAN_VELOCITY_NOISE * box.width;
+  guint i;
+
+  _axes[0].x = box.x + box.width * 0.5;
+  _axes[1].x = box.y + box.height * 0.5;
+  for (i = 0; i < 2; i++) {
+    _axes[i].v = 0.0;
+    _axes[i].p00 = r * r;
+    _axes[i].p01 = 0.0;
+    _axes[i].p11 = v * v;
+  }
+  _width = box.width;
+  _height = box.height;
+  _size_variance = r * r;
+  _initialized = TRUE;
+}
+
+/* Moves the box one frame ahead. */
+void
+CheeseKalmanBox::predict ()
+{
+  const gdouble a = CHEESE_KALMAN_ACCELERATION_NOISE * _width;
+  const gdouble s = CHEESE_KALMAN_SIZE_NOISE * _width;
+  const gdouble q = a * a;
+  guint i;
+
+  if (!_initialized)
+    return;
+
+  /* x' = x + v, with a random acceleration. */
+  for (i = 0; i < 2; i++) {
+    Axis *axis = &_axes[i];
+
+    axis->x += axis->v;
+    axis->p00 += 2 * axis->p01 + axis->p11 + q / 4;
+    axis->p01 += axis->p11 + q / 2;
+    axis->p11 += q;
+  }
+  _size_variance += s * s;
+}
+
+/* Updates the state with a measured box. */
+void
+CheeseKalmanBox::correct (const cv::Rect2d & box)
+{
+  const gdouble m = CHEESE_KALMAN_MEASUREMENT_NOISE * _width;
+  const gdouble r = m * m;
+  const gdouble z[2] = {
+    box.x + box.width * 0.5,
+    box.y + box.height * 0.5
+  };
+  gdouble k;
+  guint i;
+
+  if (!_initialized) {
+    init (box);
+    return;
+  }
+
+  for (i = 0; i < 2; i++) {
+    Axis *axis = &_axes[i];
+    const gdouble s = axis->p00 + r;
+    const gdouble k0 = axis->p00 / s;
+    const gdouble k1 = axis->p01 / s;
+    const gdouble y = z[i] - axis->x;
+
+    axis->x += k0 * y;
+    axis->v += k1 * y;
+    axis->p11 -= k1 * axis->p01;
+    axis->p00 -= k0 * axis->p00;
+    axis->p01 -= k0 * axis->p01;
+  }
+
+  k = _size_variance / (_size_variance + r);
+  _width += k * (box.width - _width);
+  _height += k * (box.height - _height);
+  _size_variance -= k * _size_variance;
+}
+
+/**
+ * Maps the state through the affine transformation @m, as when the camera
+ * moves. The velocity is only rotated and scaled, it stays the motion of the
+ * box with respect to the scene.
+ **/
+void
+CheeseKalmanBox::transform (const cv::Matx23d & m)
+{
+  const gdouble scale = sqrt (fabs (m (0, 0) * m (1, 1) - m (0, 1) * m (1, 0)));
+  const gdouble x = _axes[0].x, y = _axes[1].x;
+  const gdouble vx = _axes[0].v, vy = _axes[1].v;
+
+  if (!_initialized)
+    return;
+
+  _axes[0].x = m (0, 0) * x + m (0, 1) * y + m (0, 2);
+  _axes[1].x = m (1, 0) * x + m (1, 1) * y + m (1, 2);
+  _axes[0].v = m (0, 0) * vx + m (0, 1) * vy;
+  _axes[1].v = m (1, 0) * vx + m (1, 1) * vy;
+  _width *= scale;
+  _height *= scale;
+}
+
+cv::Rect2d
+CheeseKalmanBox::box ()
+{
+  return cv::Rect2d (_axes[0].x - _width * 0.5, _axes[1].x - _height * 0.5,
+      _width, _height);
+}
+
+/* In pixels per frame. */
+cv::Point2d
+CheeseKalmanBox::velocity ()
+{
+  return cv::Point2d (_axes[0].v, _axes[1].v);
+}
+
+/**
+ * Distance from the predicted centroid within which the measured one is
+ * expected with a 99% probability. It grows while the box is only predicted
+ * and it is never below the width of the box, a centroid that close belongs
+ * to the same face.
+ **/
+gdouble
+CheeseKalmanBox::gate_radius ()
+{
+  const gdouble m = CHEESE_KALMAN_MEASUREMENT_NOISE * _width;
+  gdouble s;
+
+  s = MAX (_axes[0].p00, _axes[1].p00) + m * m;
+  return MAX (sqrt (CHEESE_KALMAN_GATE_CHI2 * s), _width);
+}
@@ -0,0 +1,99 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_KALMAN_H__
+#define __GSTCHEESEFACE_KALMAN_H__
+
+#include <glib.h>
+#include <opencv2/core.hpp>
+
+G_BEGIN_DECLS
+
+/* Noise of the model, as fractions of the width of the box. */
+#define CHEESE_KALMAN_ACCELERATION_NOISE    0.05
+#define CHEESE_KALMAN_MEASUREMENT_NOISE     0.1
+#define CHEESE_KALMAN_SIZE_NOISE            0.02
+/* Initial uncertainty of the velocity. */
+#define CHEESE_KALMAN_VELOCITY_NOISE        0.5
+/* 99% quantile of the chi-squared distribution with 2 degrees of freedom. */
+#define CHEESE_KALMAN_GATE_CHI2             9.21
+
+/**
+ * Constant velocity Kalman filter of a bounding box, one step per frame.
+ * Each coordinate of the centroid is filtered on its own with its velocity,
+ * and the size is a random walk, so every step is a handful of scalar
+ * operations. The noise is proportional to the size of the box, so small
+ * and big faces behave the same.
+ **/
+struct CheeseKalmanBox {
+  private:
+    struct Axis {
+      gdouble x;
+      gdouble v;
+      /* Covariance of x and v. */
+      gdouble p00;
+      gdouble p01;
+      gdouble p11;
+    };
+
+    Axis _axes[2];
+    gdouble _width;
+    gdouble _height;
+    gdouble _size_variance;
+    gboolean _initialized;
+
+  public:
+    CheeseKalmanBox ();
+    gboolean initialized ();
+    void init (const cv::Rect2d & box);
+    void predict ();
+    void correct (const cv::Rect2d & box);
+    void transform (const cv::Matx23d & m);
+    cv::Rect2d box ();
+    cv::Point2d velocity ();
+    gdouble gate_radius ();
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_KALMAN_H__ */
@@ -0,0 +1,102 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "landmarkflow.h"
+
+/**
+ * Moves @landmark, placed on the previous frame of @pyramid inside
+ * @from_box, to the current frame where the face is at @to_box. This is far
+ * cheaper than running the shape predictor again. Returns FALSE, leaving
+ * @landmark as it was, if any point is lost, the flow is not reliable or
+ * the face changed too much, the landmark must be predicted again then.
+ **/
+gboolean
+cheese_landmark_flow_propagate (CheeseFlowPyramid & pyramid,
+    std::vector<cv::Point> & landmark, const cv::Rect2d & from_box,
+    const cv::Rect2d & to_box)
+{
+  const cv::Size window (CHEESE_FLOW_PYRAMID_WINDOW,
+      CHEESE_FLOW_PYRAMID_WINDOW);
+  const gdouble max_change = CHEESE_LANDMARK_FLOW_MAX_BOX_CHANGE *
+      from_box.width;
+  std::vector<cv::Point2f> from, to;
+  std::vector<guint8> status;
+  std::vector<gfloat> errors;
+  cv::Point2f offset, displacement;
+  gdouble error = 0.0;
+  guint i, n;
+
+  n = landmark.size ();
+  if (!pyramid.has_previous () || n == 0 ||
+      fabs (to_box.width - from_box.width) > max_change)
+    return FALSE;
+
+  /* The flow starts where the box moved and only refines it. */
+  offset = (to_box.tl () + to_box.br () - from_box.tl () - from_box.br ()) *
+      0.5;
+  from.resize (n);
+  to.resize (n);
+  for (i = 0; i < n; i++) {
+    from[i] = cv::Point2f (landmark[i].x, landmark[i].y);
+    to[i] = from[i] + offset;
+  }
+  cv::calcOpticalFlowPyrLK (pyramid.previous (), pyramid.current (), from, to,
+      status, errors, window, CHEESE_LANDMARK_FLOW_LEVELS,
+      cv::TermCriteria (cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 10,
+          0.03), cv::OPTFLOW_USE_INITIAL_FLOW);
+
+  for (i = 0; i < n; i++) {
+    if (!status[i])
+      return FALSE;
+    error += errors[i];
+    displacement += to[i] - from[i];
+  }
+  displacement *= 1.0f / n;
+  if (error / n > CHEESE_LANDMARK_FLOW_MAX_ERROR ||
+      cv::norm (displacement - offset) > max_change)
+    return FALSE;
+
+  for (i = 0; i < n; i++)
+    landmark[i] = cv::Point (cvRound (to[i].x), cvRound (to[i].y));
+  return TRUE;
+}
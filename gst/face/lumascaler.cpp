@@ -0,0 +1,314 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "lumascaler.h"
+
+#if defined (USE_SSE41) && (defined (__GNUC__) || defined (__clang__))
+#define CHEESE_LUMA_SCALER_SIMD
+#include <immintrin.h>
+#endif
+
+/* BT.601 weights in 8-bit fixed point, they add up to 256. */
+#define LUMA_R    77
+#define LUMA_G    150
+#define LUMA_B    29
+
+/**
+ * Converts a row of RGB pixels to luma. If @out is given the luma is written
+ * there, otherwise it is stored in @acc, or added to it if @accumulate is
+ * TRUE. All the implementations give the same results.
+ **/
+typedef void (* CheeseLumaRowFunc) (const guint8 * rgb, guint16 * acc,
+    guint8 * out, gint width, gboolean accumulate);
+
+static void
+cheese_luma_row_c (const guint8 * rgb, guint16 * acc, guint8 * out,
+    gint width, gboolean accumulate)
+{
+  gint x;
+
+  for (x = 0; x < width; x++, rgb += 3) {
+    guint16 y =
+        (LUMA_R * rgb[0] + LUMA_G * rgb[1] + LUMA_B * rgb[2] + 128) >> 8;
+    if (out)
+      out[x] = y;
+    else if (accumulate)
+      acc[x] += y;
+    else
+      acc[x] = y;
+  }
+}
+
+#ifdef CHEESE_LUMA_SCALER_SIMD
+/* Splits 16 packed RGB pixels into their three planes. */
+__attribute__ ((target ("sse4.1")))
+static inline void
+cheese_luma_deinterleave_sse41 (const guint8 * rgb, __m128i & r, __m128i & g,
+    __m128i & b)
+{
+  const __m128i p0 = _mm_loadu_si128 ((const __m128i *) rgb);
+  const __m128i p1 = _mm_loadu_si128 ((const __m128i *) (rgb + 16));
+  const __m128i p2 = _mm_loadu_si128 ((const __m128i *) (rgb + 32));
+
+  r = _mm_or_si128 (_mm_or_si128 (
+      _mm_shuffle_epi8 (p0, _mm_setr_epi8 (0, 3, 6, 9, 12, 15,
+          -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8 (p1, _mm_setr_epi8 (-1, -1, -1, -1, -1, -1,
+          2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8 (p2, _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1,
+          -1, -1, -1, 1, 4, 7, 10, 13)));
+  g = _mm_or_si128 (_mm_or_si128 (
+      _mm_shuffle_epi8 (p0, _mm_setr_epi8 (1, 4, 7, 10, 13,
+          -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8 (p1, _mm_setr_epi8 (-1, -1, -1, -1, -1,
+          0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8 (p2, _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1,
+          -1, -1, -1, 2, 5, 8, 11, 14)));
+  b = _mm_or_si128 (_mm_or_si128 (
+      _mm_shuffle_epi8 (p0, _mm_setr_epi8 (2, 5, 8, 11, 14,
+          -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8 (p1, _mm_setr_epi8 (-1, -1, -1, -1, -1,
+          1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8 (p2, _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1,
+          -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+/* Weights 8 pixels widened to 16 bits. The sum is at most 65408. */
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+cheese_luma_weight_sse41 (__m128i r, __m128i g, __m128i b)
+{
+  __m128i y;
+
+  y = _mm_mullo_epi16 (r, _mm_set1_epi16 (LUMA_R));
+  y = _mm_add_epi16 (y, _mm_mullo_epi16 (g, _mm_set1_epi16 (LUMA_G)));
+  y = _mm_add_epi16 (y, _mm_mullo_epi16 (b, _mm_set1_epi16 (LUMA_B)));
+  y = _mm_add_epi16 (y, _mm_set1_epi16 (128));
+  return _mm_srli_epi16 (y, 8);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void
+cheese_luma_row_sse41 (const guint8 * rgb, guint16 * acc, guint8 * out,
+    gint width, gboolean accumulate)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  gint x;
+
+  for (x = 0; x + 16 <= width; x += 16) {
+    __m128i r, g, b, lo, hi;
+
+    cheese_luma_deinterleave_sse41 (rgb + 3 * x, r, g, b);
+    lo = cheese_luma_weight_sse41 (_mm_cvtepu8_epi16 (r),
+        _mm_cvtepu8_epi16 (g), _mm_cvtepu8_epi16 (b));
+    hi = cheese_luma_weight_sse41 (_mm_unpackhi_epi8 (r, zero),
+        _mm_unpackhi_epi8 (g, zero), _mm_unpackhi_epi8 (b, zero));
+
+    if (out) {
+      _mm_storeu_si128 ((__m128i *) (out + x), _mm_packus_epi16 (lo, hi));
+      continue;
+    }
+    if (accumulate) {
+      lo = _mm_add_epi16 (lo, _mm_loadu_si128 ((__m128i *) (acc + x)));
+      hi = _mm_add_epi16 (hi, _mm_loadu_si128 ((__m128i *) (acc + x + 8)));
+    }
+    _mm_storeu_si128 ((__m128i *) (acc + x), lo);
+    _mm_storeu_si128 ((__m128i *) (acc + x + 8), hi);
+  }
+
+  cheese_luma_row_c (rgb + 3 * x, acc ? acc + x : NULL, out ? out + x : NULL,
+      width - x, accumulate);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+cheese_luma_row_avx2 (const guint8 * rgb, guint16 * acc, guint8 * out,
+    gint width, gboolean accumulate)
+{
+  gint x;
+
+  for (x = 0; x + 16 <= width; x += 16) {
+    __m128i r, g, b;
+    __m256i y;
+
+    cheese_luma_deinterleave_sse41 (rgb + 3 * x, r, g, b);
+    y = _mm256_mullo_epi16 (_mm256_cvtepu8_epi16 (r),
+        _mm256_set1_epi16 (LUMA_R));
+    y = _mm256_add_epi16 (y, _mm256_mullo_epi16 (_mm256_cvtepu8_epi16 (g),
+        _mm256_set1_epi16 (LUMA_G)));
+    y = _mm256_add_epi16 (y, _mm256_mullo_epi16 (_mm256_cvtepu8_epi16 (b),
+        _mm256_set1_epi16 (LUMA_B)));
+    y = _mm256_add_epi16 (y, _mm256_set1_epi16 (128));
+    y = _mm256_srli_epi16 (y, 8);
+
+    if (out) {
+      _mm_storeu_si128 ((__m128i *) (out + x),
+          _mm_packus_epi16 (_mm256_castsi256_si128 (y),
+              _mm256_extracti128_si256 (y, 1)));
+      continue;
+    }
+    if (accumulate)
+      y = _mm256_add_epi16 (y, _mm256_loadu_si256 ((__m256i *) (acc + x)));
+    _mm256_storeu_si256 ((__m256i *) (acc + x), y);
+  }
+
+  cheese_luma_row_c (rgb + 3 * x, acc ? acc + x : NULL, out ? out + x : NULL,
+      width - x, accumulate);
+}
+#endif
+
+static CheeseLumaRowFunc
+cheese_luma_row_func (void)
+{
+  static gsize func = 0;
+
+  if (g_once_init_enter (&func)) {
+    CheeseLumaRowFunc row = cheese_luma_row_c;
+#ifdef CHEESE_LUMA_SCALER_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+      row = cheese_luma_row_avx2;
+    else if (__builtin_cpu_supports ("sse4.1"))
+      row = cheese_luma_row_sse41;
+#endif
+    g_once_init_leave (&func, (gsize) row);
+  }
+
+  return (CheeseLumaRowFunc) func;
+}
+
+CheeseLumaScaler::CheeseLumaScaler ()
+{
+  simd = TRUE;
+}
+
+/* Gives a view of @size on a buffer no earlier frame still refers to. */
+cv::Mat
+CheeseLumaScaler::buffer (cv::Size size)
+{
+  gint stride = (size.width + CHEESE_LUMA_SCALER_ALIGN - 1) /
+      CHEESE_LUMA_SCALER_ALIGN * CHEESE_LUMA_SCALER_ALIGN;
+  cv::Rect view (0, 0, size.width, size.height);
+  guint i;
+
+  for (i = 0; i < _buffers.size (); i++) {
+    cv::Mat & buf = _buffers[i];
+    if (buf.u && buf.u->refcount > 1)
+      continue;
+    buf.create (size.height, stride, CV_8UC1);
+    return buf (view);
+  }
+
+  _buffers.push_back (cv::Mat (size.height, stride, CV_8UC1));
+  return _buffers.back () (view);
+}
+
+/* Converts @img to luma and averages it over @factor x @factor boxes. */
+void
+CheeseLumaScaler::box (cv::Mat & img, guint factor, cv::Mat & dst)
+{
+  CheeseLumaRowFunc row =
+      simd ? cheese_luma_row_func () : cheese_luma_row_c;
+  const gint width = dst.cols * factor;
+  const guint area = factor * factor;
+  guint16 *acc;
+  gint x, y;
+  guint i;
+
+  if (factor == 1) {
+    for (y = 0; y < dst.rows; y++)
+      row (img.ptr<guint8> (y), NULL, dst.ptr<guint8> (y), dst.cols, FALSE);
+    return;
+  }
+
+  /* Each column of a box adds up to CHEESE_LUMA_SCALER_MAX_BOX * 255. */
+  _acc.create (1, width, CV_16UC1);
+  acc = _acc.ptr<guint16> ();
+  for (y = 0; y < dst.rows; y++) {
+    guint8 *out = dst.ptr<guint8> (y);
+
+    for (i = 0; i < factor; i++)
+      row (img.ptr<guint8> (y * factor + i), acc, NULL, width, i > 0);
+    for (x = 0; x < dst.cols; x++) {
+      guint sum = 0;
+      for (i = 0; i < factor; i++)
+        sum += acc[x * factor + i];
+      out[x] = (sum + area / 2) / area;
+    }
+  }
+}
+
+/**
+ * Gives the luma of @img scaled by @scale_factor, the same size cv::resize
+ * would give. Single plane images are only resized, or returned as they are
+ * if they keep their size.
+ **/
+cv::Mat
+CheeseLumaScaler::scale (cv::Mat & img, gdouble scale_factor)
+{
+  cv::Size size (MAX ((gint) (img.cols * scale_factor), 1),
+      MAX ((gint) (img.rows * scale_factor), 1));
+  guint factor = CLAMP ((gint) (1.0 / scale_factor + 1e-6), 1,
+      CHEESE_LUMA_SCALER_MAX_BOX);
+  cv::Size boxed (img.cols / factor, img.rows / factor);
+  cv::Mat dst;
+
+  if (img.channels () == 1) {
+    if (size == img.size ())
+      return img;
+    dst = buffer (size);
+    cv::resize (img, dst, size, 0, 0, cv::INTER_AREA);
+    return dst;
+  }
+
+  dst = buffer (size);
+  if (boxed == size) {
+    box (img, factor, dst);
+  } else {
+    _boxed.create (boxed, CV_8UC1);
+    box (img, factor, _boxed);
+    cv::resize (_boxed, dst, size, 0, 0, cv::INTER_LINEAR);
+  }
+
+  return dst;
+}
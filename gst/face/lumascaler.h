@@ -0,0 +1,86 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_LUMA_SCALER_H__
+#define __GSTCHEESEFACE_LUMA_SCALER_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+
+G_BEGIN_DECLS
+
+/* Rows of the scaled images start at multiples of this many bytes. */
+#define CHEESE_LUMA_SCALER_ALIGN        32
+/* Largest factor downscaled with a box filter while converting to luma. */
+#define CHEESE_LUMA_SCALER_MAX_BOX      16
+
+/**
+ * Converts RGB frames to 8-bit luma and downscales them in a single pass,
+ * the detector and the shape predictor only need intensities. The integer
+ * part of the downscale is a box filter fused with the conversion, any
+ * remainder is a bilinear resize of the much smaller luma image.
+ *
+ * The scaled images are views on buffers owned by the scaler. A buffer is
+ * reused once every view on it has been released, so frames held by a
+ * pipeline keep their own.
+ **/
+struct CheeseLumaScaler {
+  private:
+    std::vector<cv::Mat> _buffers;
+    cv::Mat _acc;
+    cv::Mat _boxed;
+
+    cv::Mat buffer (cv::Size size);
+    void box (cv::Mat & img, guint factor, cv::Mat & dst);
+
+  public:
+    /* FALSE converts with the plain C rows, which give the same results. */
+    gboolean simd;
+
+    CheeseLumaScaler ();
+    cv::Mat scale (cv::Mat & img, gdouble scale_factor);
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_LUMA_SCALER_H__ */
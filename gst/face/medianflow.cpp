@@ -0,0 +1,166 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "medianflow.h"
+
+#include <algorithm>
+
+/* Median of @values, which are reordered. */
+static gfloat
+cheese_median (std::vector<gfloat> & values)
+{
+  std::vector<gfloat>::iterator middle = values.begin () + values.size () / 2;
+
+  std::nth_element (values.begin (), middle, values.end ());
+  return *middle;
+}
+
+CheeseMedianFlow::CheeseMedianFlow ()
+{
+  fb_error = 0.0;
+}
+
+/**
+ * Moves @box, on the previous frame of @pyramid, to the current one.
+ * Returns FALSE, leaving @box as it was, if the target is lost.
+ **/
+gboolean
+CheeseMedianFlow::update (CheeseFlowPyramid & pyramid, cv::Rect2d & box)
+{
+  const cv::Size window (CHEESE_FLOW_PYRAMID_WINDOW,
+      CHEESE_FLOW_PYRAMID_WINDOW);
+  const guint n = CHEESE_MEDIAN_FLOW_GRID * CHEESE_MEDIAN_FLOW_GRID;
+  const cv::Size frame_size = pyramid.size ();
+  const cv::Rect2d frame (0, 0, frame_size.width, frame_size.height);
+  gdouble dx, dy, scale, fb_threshold;
+  cv::Point2d centroid;
+  cv::Size2d size;
+  guint i, j, k;
+
+  if (!pyramid.has_previous () || box.area () <= 0)
+    return FALSE;
+
+  _points.resize (n);
+  for (i = 0; i < CHEESE_MEDIAN_FLOW_GRID; i++) {
+    for (j = 0; j < CHEESE_MEDIAN_FLOW_GRID; j++) {
+      _points[i * CHEESE_MEDIAN_FLOW_GRID + j] = cv::Point2f (
+          box.x + (j + 0.5) * box.width / CHEESE_MEDIAN_FLOW_GRID,
+          box.y + (i + 0.5) * box.height / CHEESE_MEDIAN_FLOW_GRID);
+    }
+  }
+
+  cv::calcOpticalFlowPyrLK (pyramid.previous (), pyramid.current (), _points,
+      _forward, _status, _errors, window, CHEESE_FLOW_PYRAMID_LEVELS);
+  cv::calcOpticalFlowPyrLK (pyramid.current (), pyramid.previous (), _forward,
+      _backward, _back_status, _errors, window, CHEESE_FLOW_PYRAMID_LEVELS);
+
+  /* Forward-backward error of the points followed both ways. */
+  _kept.clear ();
+  _fb_errors.clear ();
+  for (i = 0; i < n; i++) {
+    if (_status[i] && _back_status[i]) {
+      _kept.push_back (i);
+      _fb_errors.push_back (cv::norm (_points[i] - _backward[i]));
+    }
+  }
+  if (_kept.size () < CHEESE_MEDIAN_FLOW_MIN_VALID * n)
+    return FALSE;
+
+  /* Keep the most reliable half. */
+  _values = _fb_errors;
+  fb_threshold = cheese_median (_values);
+  fb_error = fb_threshold;
+  for (i = 0, k = 0; i < _kept.size (); i++) {
+    if (_fb_errors[i] <= fb_threshold)
+      _kept[k++] = _kept[i];
+  }
+  _kept.resize (k);
+
+  _dx.clear ();
+  _dy.clear ();
+  for (i = 0; i < _kept.size (); i++) {
+    const cv::Point2f d = _forward[_kept[i]] - _points[_kept[i]];
+    _dx.push_back (d.x);
+    _dy.push_back (d.y);
+  }
+  _values = _dx;
+  dx = cheese_median (_values);
+  _values = _dy;
+  dy = cheese_median (_values);
+
+  /* The target is lost if the points do not move together. */
+  _values.clear ();
+  for (i = 0; i < _kept.size (); i++)
+    _values.push_back (cv::norm (cv::Point2f (_dx[i] - dx, _dy[i] - dy)));
+  if (cheese_median (_values) > CHEESE_MEDIAN_FLOW_MAX_DISPERSION)
+    return FALSE;
+
+  /* Change of scale, the median ratio of the distances between points. */
+  _values.clear ();
+  for (i = 0; i < _kept.size (); i++) {
+    for (j = i + 1; j < _kept.size (); j++) {
+      const gdouble before = cv::norm (_points[_kept[i]] - _points[_kept[j]]);
+      const gdouble after = cv::norm (_forward[_kept[i]] - _forward[_kept[j]]);
+      if (before > 0)
+        _values.push_back (after / before);
+    }
+  }
+  scale = _values.empty () ? 1.0 : cheese_median (_values);
+
+  centroid = (box.tl () + box.br ()) * 0.5 + cv::Point2d (dx, dy);
+  size = box.size () * scale;
+  cv::Rect2d moved (centroid - cv::Point2d (size) * 0.5, size);
+  if (moved.width < 1 || (moved & frame).area () <= 0)
+    return FALSE;
+
+  box = moved;
+  return TRUE;
+}
+
+/* How sure the last update is, from 1 without forward-backward error to 0 at
+ * CHEESE_MEDIAN_FLOW_MAX_FB_ERROR. */
+gdouble
+CheeseMedianFlow::confidence ()
+{
+  return CLAMP (1.0 - fb_error / CHEESE_MEDIAN_FLOW_MAX_FB_ERROR, 0.0, 1.0);
+}
@@ -0,0 +1,101 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_MEDIAN_FLOW_H__
+#define __GSTCHEESEFACE_MEDIAN_FLOW_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+#include "flowpyramid.h"
+
+G_BEGIN_DECLS
+
+/* Points followed in the box, on a square grid of this side. */
+#define CHEESE_MEDIAN_FLOW_GRID             10
+/* Median distance, in pixels, of the displacements to their median above
+ * which the points do not move together and the target is lost. */
+#define CHEESE_MEDIAN_FLOW_MAX_DISPERSION   10.0
+/* Median forward-backward error, in pixels, at which the tracker has no
+ * confidence left. */
+#define CHEESE_MEDIAN_FLOW_MAX_FB_ERROR     4.0
+/* Fraction of the points that must be followed both ways. */
+#define CHEESE_MEDIAN_FLOW_MIN_VALID        0.1
+
+/**
+ * Median flow tracker, Kalal et al., "Forward-Backward Error: Automatic
+ * Detection of Tracking Failures", ICPR 2010. A grid of points of the box is
+ * followed forward and then back with Lucas-Kanade, the half with the lowest
+ * forward-backward error is kept and the box moves by their median
+ * displacement and scales by the median change of their distances. Unlike
+ * cv::TrackerMedianFlow it does not build pyramids of its own, it reads the
+ * ones shared by all the faces of the frame.
+ **/
+struct CheeseMedianFlow {
+  private:
+    std::vector<cv::Point2f> _points;
+    std::vector<cv::Point2f> _forward;
+    std::vector<cv::Point2f> _backward;
+    std::vector<guint8> _status;
+    std::vector<guint8> _back_status;
+    std::vector<gfloat> _errors;
+    std::vector<gfloat> _fb_errors;
+    std::vector<guint> _kept;
+    std::vector<gfloat> _dx;
+    std::vector<gfloat> _dy;
+    std::vector<gfloat> _values;
+
+  public:
+    /* Median forward-backward error of the last update, in pixels. */
+    gdouble fb_error;
+
+    CheeseMedianFlow ();
+    gboolean update (CheeseFlowPyramid & pyramid, cv::Rect2d & box);
+    gdouble confidence ();
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_MEDIAN_FLOW_H__ */
@@ -0,0 +1,317 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "mosse.h"
+
+#include <math.h>
+
+#define CHEESE_MOSSE_N        (CHEESE_MOSSE_SIZE * CHEESE_MOSSE_SIZE)
+
+CheeseMosse::CheeseMosse ()
+{
+  const gint center = CHEESE_MOSSE_SIZE / 2;
+  cv::Mat response (CHEESE_MOSSE_SIZE, CHEESE_MOSSE_SIZE, CV_32FC1);
+  gint x, y;
+
+  _busy = 0;
+
+  /* The desired response peaks at the center, where the target is. */
+  for (y = 0; y < CHEESE_MOSSE_SIZE; y++) {
+    for (x = 0; x < CHEESE_MOSSE_SIZE; x++) {
+      response.at<gfloat> (y, x) = exp (-((x - center) * (x - center) +
+          (y - center) * (y - center)) /
+          (2.0 * CHEESE_MOSSE_SIGMA * CHEESE_MOSSE_SIGMA));
+    }
+  }
+  cv::dft (response, _target, cv::DFT_COMPLEX_OUTPUT);
+  cv::createHanningWindow (_window,
+      cv::Size (CHEESE_MOSSE_SIZE, CHEESE_MOSSE_SIZE), CV_32FC1);
+}
+
+/**
+ * Returns a free slot, growing the filters if there is none. Growing moves
+ * the rows of every slot, so it must not happen while any slot is tracked or
+ * trained: call it from the streaming thread only, between the parallel
+ * updates of the trackers.
+ **/
+gint
+CheeseMosse::add ()
+{
+  gint slot;
+
+  g_assert (g_atomic_int_get (&_busy) == 0);
+
+  if (!_free.empty ()) {
+    slot = _free.back ();
+    _free.pop_back ();
+    return slot;
+  }
+
+  slot = _psr.size ();
+  _numerators.push_back (cv::Mat::zeros (1, CHEESE_MOSSE_N, CV_32FC2));
+  _denominators.push_back (cv::Mat::zeros (1, CHEESE_MOSSE_N, CV_32FC1));
+  _patches.push_back (cv::Mat::zeros (1, CHEESE_MOSSE_N, CV_32FC1));
+  _spectra.push_back (cv::Mat::zeros (1, CHEESE_MOSSE_N, CV_32FC2));
+  _pixels.push_back (cv::Mat ());
+  _psr.push_back (0.0);
+  return slot;
+}
+
+void
+CheeseMosse::remove (gint slot)
+{
+  g_return_if_fail (slot >= 0 && (guint) slot < _psr.size ());
+  g_assert (g_atomic_int_get (&_busy) == 0);
+
+  _free.push_back (slot);
+}
+
+/**
+ * Samples the region around @box, rotated by @angle and scaled by @scale,
+ * into the patch of @slot and leaves its spectrum in the spectra. @frame is
+ * 8 bit, its channels are averaged.
+ **/
+void
+CheeseMosse::extract (guint slot, cv::Mat & frame, const cv::Rect2d & box,
+    gdouble angle, gdouble scale)
+{
+  const gdouble width = box.width * CHEESE_MOSSE_PADDING * scale;
+  const gdouble height = box.height * CHEESE_MOSSE_PADDING * scale;
+  const gdouble half = CHEESE_MOSSE_SIZE / 2;
+  const cv::Point2d center = (box.tl () + box.br ()) * 0.5;
+  cv::Mat & pixels = _pixels[slot];
+  cv::Mat patch = _patches.row (slot).reshape (1, CHEESE_MOSSE_SIZE);
+  cv::Mat spectrum = _spectra.row (slot).reshape (2, CHEESE_MOSSE_SIZE);
+  gfloat *p = _patches.ptr<gfloat> (slot);
+  const gfloat *w = _window.ptr<gfloat> ();
+  gdouble sum = 0.0, sum_squares = 0.0, mean, deviation;
+  guint channels, x, y, c;
+
+  /* Maps the filter pixels to the frame. */
+  cv::Matx23d warp (
+      cos (angle) * width / CHEESE_MOSSE_SIZE,
+      -sin (angle) * height / CHEESE_MOSSE_SIZE, 0,
+      sin (angle) * width / CHEESE_MOSSE_SIZE,
+      cos (angle) * height / CHEESE_MOSSE_SIZE, 0);
+  warp (0, 2) = center.x - (warp (0, 0) + warp (0, 1)) * half;
+  warp (1, 2) = center.y - (warp (1, 0) + warp (1, 1)) * half;
+  cv::warpAffine (frame, pixels, warp,
+      cv::Size (CHEESE_MOSSE_SIZE, CHEESE_MOSSE_SIZE),
+      cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+
+  /* Log of the intensity, to zero mean and unit variance, then windowed. */
+  channels = pixels.channels ();
+  for (y = 0; y < CHEESE_MOSSE_SIZE; y++) {
+    const guint8 *row = pixels.ptr<guint8> (y);
+    for (x = 0; x < CHEESE_MOSSE_SIZE; x++) {
+      gfloat v = 0.0;
+      for (c = 0; c < channels; c++)
+        v += row[x * channels + c];
+      v = logf (1.0f + v / channels);
+      p[y * CHEESE_MOSSE_SIZE + x] = v;
+      sum += v;
+      sum_squares += v * v;
+    }
+  }
+  mean = sum / CHEESE_MOSSE_N;
+  deviation = sqrt (MAX (sum_squares / CHEESE_MOSSE_N - mean * mean, 0.0)) +
+      1e-5;
+  for (x = 0; x < CHEESE_MOSSE_N; x++)
+    p[x] = (p[x] - mean) / deviation * w[x];
+
+  cv::dft (patch, spectrum, cv::DFT_COMPLEX_OUTPUT);
+}
+
+/**
+ * Blends the spectrum of @slot into its filter with weight @rate:
+ * A = G conj (F) and B = F conj (F), so that A / B maps F to the desired
+ * response G.
+ **/
+void
+CheeseMosse::train (guint slot, gdouble rate)
+{
+  const gfloat *f = _spectra.ptr<gfloat> (slot);
+  const gfloat *g = _target.ptr<gfloat> ();
+  gfloat *a = _numerators.ptr<gfloat> (slot);
+  gfloat *b = _denominators.ptr<gfloat> (slot);
+  const gfloat keep = 1.0 - rate;
+  guint k;
+
+  for (k = 0; k < CHEESE_MOSSE_N; k++) {
+    const gfloat fr = f[2 * k], fi = f[2 * k + 1];
+    const gfloat gr = g[2 * k], gi = g[2 * k + 1];
+
+    a[2 * k] = rate * (gr * fr + gi * fi) + keep * a[2 * k];
+    a[2 * k + 1] = rate * (gi * fr - gr * fi) + keep * a[2 * k + 1];
+    b[k] = rate * (fr * fr + fi * fi) + keep * b[k];
+  }
+}
+
+/**
+ * Correlates the spectrum of @slot with its filter, leaving the position of
+ * the highest response in @peak. Returns the peak to sidelobe ratio.
+ **/
+gfloat
+CheeseMosse::correlate (guint slot, cv::Point & peak)
+{
+  gfloat *f = _spectra.ptr<gfloat> (slot);
+  const gfloat *a = _numerators.ptr<gfloat> (slot);
+  const gfloat *b = _denominators.ptr<gfloat> (slot);
+  const gfloat *r = _patches.ptr<gfloat> (slot);
+  cv::Mat spectrum = _spectra.row (slot).reshape (2, CHEESE_MOSSE_SIZE);
+  cv::Mat response = _patches.row (slot).reshape (1, CHEESE_MOSSE_SIZE);
+  gdouble max, sum = 0.0, sum_squares = 0.0, mean, deviation;
+  guint n = 0, k;
+  gint x, y;
+
+  /* F A / B, in place. */
+  for (k = 0; k < CHEESE_MOSSE_N; k++) {
+    const gfloat fr = f[2 * k], fi = f[2 * k + 1];
+    const gfloat d = b[k] + CHEESE_MOSSE_REGULARIZATION;
+
+    f[2 * k] = (fr * a[2 * k] - fi * a[2 * k + 1]) / d;
+    f[2 * k + 1] = (fr * a[2 * k + 1] + fi * a[2 * k]) / d;
+  }
+  cv::idft (spectrum, response, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+  cv::minMaxLoc (response, NULL, &max, NULL, &peak);
+
+  /* The sidelobe is everything but a window around the peak. */
+  for (y = 0; y < CHEESE_MOSSE_SIZE; y++) {
+    for (x = 0; x < CHEESE_MOSSE_SIZE; x++) {
+      const gfloat v = r[y * CHEESE_MOSSE_SIZE + x];
+      if (ABS (x - peak.x) <= CHEESE_MOSSE_PEAK_RADIUS &&
+          ABS (y - peak.y) <= CHEESE_MOSSE_PEAK_RADIUS)
+        continue;
+      sum += v;
+      sum_squares += v * v;
+      n++;
+    }
+  }
+  mean = sum / n;
+  deviation = sqrt (MAX (sum_squares / n - mean * mean, 0.0)) + 1e-5;
+  return (max - mean) / deviation;
+}
+
+/**
+ * Trains the filter of @slot on @box. A few rotated and scaled samples
+ * are averaged so the first frames are followed despite small changes.
+ **/
+void
+CheeseMosse::init (gint slot, cv::Mat & frame, const cv::Rect2d & box)
+{
+  static const gdouble perturbations[][2] = {
+    { 0.0, 1.0 }, { -0.1, 1.0 }, { 0.1, 1.0 }, { 0.0, 0.95 }, { 0.0, 1.05 }
+  };
+  guint i;
+
+  g_return_if_fail (slot >= 0 && (guint) slot < _psr.size ());
+
+  g_atomic_int_inc (&_busy);
+  for (i = 0; i < G_N_ELEMENTS (perturbations); i++) {
+    extract (slot, frame, box, perturbations[i][0], perturbations[i][1]);
+    /* The running mean of the samples. */
+    train (slot, 1.0 / (i + 1));
+  }
+  _psr[slot] = 0.0;
+  g_atomic_int_add (&_busy, -1);
+}
+
+/**
+ * Moves @box to where the filter of @slot responds the most and adapts the
+ * filter there. Returns FALSE, leaving @box as it was, if the response is
+ * not sharp enough to be the target or the box leaves the frame.
+ **/
+gboolean
+CheeseMosse::track (gint slot, cv::Mat & frame, cv::Rect2d & box)
+{
+  const cv::Rect2d bounds (0, 0, frame.cols, frame.rows);
+  cv::Point peak;
+  cv::Rect2d moved;
+  gdouble dx, dy;
+  gboolean found = FALSE;
+
+  g_return_val_if_fail (slot >= 0 && (guint) slot < _psr.size (), FALSE);
+
+  g_atomic_int_inc (&_busy);
+  extract (slot, frame, box, 0.0, 1.0);
+  _psr[slot] = correlate (slot, peak);
+  if (_psr[slot] < CHEESE_MOSSE_MIN_PSR)
+    goto done;
+
+  dx = (peak.x - CHEESE_MOSSE_SIZE / 2) * box.width * CHEESE_MOSSE_PADDING /
+      CHEESE_MOSSE_SIZE;
+  dy = (peak.y - CHEESE_MOSSE_SIZE / 2) * box.height * CHEESE_MOSSE_PADDING /
+      CHEESE_MOSSE_SIZE;
+  moved = cv::Rect2d (box.x + dx, box.y + dy, box.width, box.height);
+  if ((moved & bounds).area () <= 0)
+    goto done;
+
+  extract (slot, frame, moved, 0.0, 1.0);
+  train (slot, CHEESE_MOSSE_LEARNING_RATE);
+  box = moved;
+  found = TRUE;
+
+done:
+  g_atomic_int_add (&_busy, -1);
+  return found;
+}
+
+/* Peak to sidelobe ratio of the last track of @slot. */
+gfloat
+CheeseMosse::psr (gint slot)
+{
+  g_return_val_if_fail (slot >= 0 && (guint) slot < _psr.size (), 0.0);
+
+  return _psr[slot];
+}
+
+/* How sure the last track of @slot is, from 0 at CHEESE_MOSSE_MIN_PSR to 1
+ * at CHEESE_MOSSE_GOOD_PSR. */
+gdouble
+CheeseMosse::confidence (gint slot)
+{
+  const gdouble psr = this->psr (slot);
+
+  return CLAMP ((psr - CHEESE_MOSSE_MIN_PSR) /
+      (CHEESE_MOSSE_GOOD_PSR - CHEESE_MOSSE_MIN_PSR), 0.0, 1.0);
+}
@@ -0,0 +1,113 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_MOSSE_H__
+#define __GSTCHEESEFACE_MOSSE_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+/* Side of the filters, the FFT is fastest on a power of two. */
+#define CHEESE_MOSSE_SIZE                   32
+/* Side of the searched region with respect to the box. */
+#define CHEESE_MOSSE_PADDING                2.0
+/* Standard deviation of the desired response, in filter pixels. */
+#define CHEESE_MOSSE_SIGMA                  2.0
+#define CHEESE_MOSSE_LEARNING_RATE          0.125
+#define CHEESE_MOSSE_REGULARIZATION         0.01
+/* Peak to sidelobe ratio below which the target is lost, Bolme et al. find
+ * it between 20 and 60 while tracking and below 7 on failures. */
+#define CHEESE_MOSSE_MIN_PSR                7.0
+/* Peak to sidelobe ratio from which the tracker is fully confident. */
+#define CHEESE_MOSSE_GOOD_PSR               20.0
+/* Half side of the window around the peak left out of the sidelobe. */
+#define CHEESE_MOSSE_PEAK_RADIUS            5
+
+/**
+ * MOSSE correlation filters, Bolme et al., "Visual Object Tracking using
+ * Adaptive Correlation Filters", CVPR 2010, for all the faces of the element.
+ * Each face owns a slot. The filters of all the slots are rows of the same
+ * few matrices instead of one cv::Tracker instance each, so tracking a face
+ * allocates nothing and touches only its rows: slots may be tracked from any
+ * thread, while they are added and removed from the streaming thread only,
+ * when no slot is being tracked.
+ **/
+struct CheeseMosse {
+  private:
+    /* Structure of arrays, row i of each belongs to slot i. */
+    cv::Mat _numerators;
+    cv::Mat _denominators;
+    cv::Mat _patches;
+    cv::Mat _spectra;
+    std::vector<cv::Mat> _pixels;
+    std::vector<gfloat> _psr;
+    std::vector<guint> _free;
+    /* Slots being tracked or trained right now, add () and remove () assert
+     * there is none. */
+    gint _busy;
+
+    cv::Mat _target;
+    cv::Mat _window;
+
+    void extract (guint slot, cv::Mat & frame, const cv::Rect2d & box,
+        gdouble angle, gdouble scale);
+    void train (guint slot, gdouble rate);
+    gfloat correlate (guint slot, cv::Point & peak);
+
+  public:
+    CheeseMosse ();
+    gint add ();
+    void remove (gint slot);
+    void init (gint slot, cv::Mat & frame, const cv::Rect2d & box);
+    gboolean track (gint slot, cv::Mat & frame, cv::Rect2d & box);
+    gfloat psr (gint slot);
+    gdouble confidence (gint slot);
+};
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_MOSSE_H__ */
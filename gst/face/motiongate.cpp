@@ -0,0 +1,201 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "motiongate.h"
+
+/* Downscales @img by CHEESE_MOTION_GATE_DOWNSCALE into @luma, @small is
+ * scratch space for color images. */
+void
+cheese_motion_gate_downscale_luma (cv::Mat & img, cv::Mat & small,
+    cv::Mat & luma)
+{
+  cv::Size size (MAX (img.cols / CHEESE_MOTION_GATE_DOWNSCALE, 1),
+      MAX (img.rows / CHEESE_MOTION_GATE_DOWNSCALE, 1));
+
+  if (img.channels () == 1) {
+    cv::resize (img, luma, size, 0, 0, cv::INTER_AREA);
+  } else {
+    cv::resize (img, small, size, 0, 0, cv::INTER_AREA);
+    cv::cvtColor (small, luma, cv::COLOR_RGB2GRAY);
+  }
+}
+
+CheeseMotionGate::CheeseMotionGate ()
+{
+  threshold = 0.0;
+}
+
+/* Forgets the reference, the next image is scanned entirely. */
+void
+CheeseMotionGate::reset ()
+{
+  _reference.release ();
+  _dets.clear ();
+}
+
+/**
+ * Gives the regions of @img that changed since they were last scanned, the
+ * whole image if there is no reference yet. The reference is updated in the
+ * given regions, as they are expected to be scanned now.
+ **/
+void
+CheeseMotionGate::changed_regions (cv::Mat & img,
+    std::vector<cv::Rect> & regions)
+{
+  cv::Size size (MAX (img.cols / CHEESE_MOTION_GATE_DOWNSCALE, 1),
+      MAX (img.rows / CHEESE_MOTION_GATE_DOWNSCALE, 1));
+  cv::Size grid (
+      (size.width + CHEESE_MOTION_GATE_TILE_SIZE - 1) /
+          CHEESE_MOTION_GATE_TILE_SIZE,
+      (size.height + CHEESE_MOTION_GATE_TILE_SIZE - 1) /
+          CHEESE_MOTION_GATE_TILE_SIZE);
+  gdouble scale_x = (gdouble) img.cols / size.width;
+  gdouble scale_y = (gdouble) img.rows / size.height;
+  gint i, n_labels;
+
+  cheese_motion_gate_downscale_luma (img, _small, _luma);
+
+  if (_reference.size () != _luma.size ()) {
+    _luma.copyTo (_reference);
+    regions.push_back (cv::Rect (0, 0, img.cols, img.rows));
+    return;
+  }
+
+  /* Area interpolation averages the difference over each tile. */
+  cv::absdiff (_luma, _reference, _diff);
+  cv::resize (_diff, _tiles, grid, 0, 0, cv::INTER_AREA);
+  _mask = _tiles > threshold;
+  cv::dilate (_mask, _mask, cv::Mat ());
+
+  n_labels = cv::connectedComponentsWithStats (_mask, _labels, _stats,
+      _centroids, 8);
+  /* Label 0 is the unchanged background. */
+  for (i = 1; i < n_labels; i++) {
+    cv::Rect tiles (_stats.at<gint> (i, cv::CC_STAT_LEFT),
+        _stats.at<gint> (i, cv::CC_STAT_TOP),
+        _stats.at<gint> (i, cv::CC_STAT_WIDTH),
+        _stats.at<gint> (i, cv::CC_STAT_HEIGHT));
+    cv::Rect area (tiles.x * CHEESE_MOTION_GATE_TILE_SIZE,
+        tiles.y * CHEESE_MOTION_GATE_TILE_SIZE,
+        tiles.width * CHEESE_MOTION_GATE_TILE_SIZE,
+        tiles.height * CHEESE_MOTION_GATE_TILE_SIZE);
+
+    area &= cv::Rect (0, 0, size.width, size.height);
+    _luma (area).copyTo (_reference (area));
+    regions.push_back (cv::Rect (area.x * scale_x, area.y * scale_y,
+        area.width * scale_x, area.height * scale_y));
+  }
+}
+
+/**
+ * Detects the faces in the regions of @img that changed and keeps the
+ * previous detections elsewhere. A region is grown to the detections it cuts
+ * so those faces are scanned whole.
+ **/
+std::vector<dlib::rectangle>
+CheeseMotionGate::detect (CheeseFaceDetector & detector, cv::Mat & img)
+{
+  cv::Rect bounds (0, 0, img.cols, img.rows);
+  std::vector<cv::Rect> regions;
+  std::vector<dlib::rectangle> found;
+  std::vector<dlib::rectangle> dets;
+  guint i, j;
+
+  changed_regions (img, regions);
+  if (regions.empty ())
+    return _dets;
+
+  if (regions.size () == 1 && regions[0] == bounds) {
+    _dets = detector.detect (img);
+    return _dets;
+  }
+
+  for (i = 0; i < regions.size (); i++) {
+    for (j = 0; j < _dets.size (); j++) {
+      cv::Rect det (_dets[j].left (), _dets[j].top (), _dets[j].width (),
+          _dets[j].height ());
+      if ((regions[i] & det).area () > 0)
+        regions[i] |= det;
+    }
+    regions[i] &= bounds;
+  }
+
+  found = detector.detect_regions (img, regions);
+
+  for (j = 0; j < _dets.size (); j++) {
+    cv::Rect det (_dets[j].left (), _dets[j].top (), _dets[j].width (),
+        _dets[j].height ());
+    gboolean changed = FALSE;
+    for (i = 0; i < regions.size () && !changed; i++)
+      changed = (regions[i] & det).area () > 0;
+    if (!changed)
+      dets.push_back (_dets[j]);
+  }
+  dets.insert (dets.end (), found.begin (), found.end ());
+  _dets = dets;
+
+  return dets;
+}
+
+void
+CheeseSceneChange::reset ()
+{
+  _previous.release ();
+}
+
+/**
+ * Gives the change between @img and the previous image, from 0 to 255. The
+ * first image, or one of a different size, is a complete change.
+ **/
+gdouble
+CheeseSceneChange::update (cv::Mat & img)
+{
+  gdouble change = 255.0;
+
+  cheese_motion_gate_downscale_luma (img, _small, _luma);
+  if (_previous.size () == _luma.size ())
+    change = cv::norm (_luma, _previous, cv::NORM_L1) / _luma.total ();
+  cv::swap (_luma, _previous);
+
+  return change;
+}
@@ -0,0 +1,110 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_MOTION_GATE_H__
+#define __GSTCHEESEFACE_MOTION_GATE_H__
+
+#include <glib.h>
+#include <opencv2/opencv.hpp>
+#include <dlib/image_processing.h>
+
+#include "facedetector.h"
+
+G_BEGIN_DECLS
+
+/* The luma plane is compared at this fraction of the size of the image. */
+#define CHEESE_MOTION_GATE_DOWNSCALE    4
+/* Side of the tiles of the change mask, in downscaled pixels. */
+#define CHEESE_MOTION_GATE_TILE_SIZE    16
+
+/**
+ * Restricts face detection to the parts of the image that changed. The image
+ * is compared with a downscaled luma reference, tile by tile. The changed
+ * tiles, grown by one tile on each side, are scanned again while the
+ * detections outside of them are kept from the previous scans.
+ **/
+struct CheeseMotionGate {
+  private:
+    cv::Mat _small;
+    cv::Mat _luma;
+    cv::Mat _reference;
+    cv::Mat _diff;
+    cv::Mat _tiles;
+    cv::Mat _mask;
+    cv::Mat _labels;
+    cv::Mat _stats;
+    cv::Mat _centroids;
+    std::vector<dlib::rectangle> _dets;
+
+  public:
+    /* Mean absolute luma difference above which a tile changed. */
+    gdouble threshold;
+
+    CheeseMotionGate ();
+    void reset ();
+    void changed_regions (cv::Mat & img, std::vector<cv::Rect> & regions);
+    std::vector<dlib::rectangle> detect (CheeseFaceDetector & detector,
+        cv::Mat & img);
+};
+
+/**
+ * Measures how much the whole image changes from one frame to the next, as
+ * the mean absolute difference of their downscaled luma planes.
+ **/
+struct CheeseSceneChange {
+  private:
+    cv::Mat _small;
+    cv::Mat _luma;
+    cv::Mat _previous;
+
+  public:
+    void reset ();
+    gdouble update (cv::Mat & img);
+};
+
+void cheese_motion_gate_downscale_luma (cv::Mat & img, cv::Mat & small,
+    cv::Mat & luma);
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_MOTION_GATE_H__ */
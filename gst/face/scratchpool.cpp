@@ -0,0 +1,145 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "scratchpool.h"
+
+/* Bytes between the rows of an image of @width pixels of @type. */
+static gsize
+cheese_scratch_pool_stride (gint width, gint type)
+{
+  gsize row = width * CV_ELEM_SIZE (type);
+
+  return (row + CHEESE_SCRATCH_POOL_ALIGN - 1) / CHEESE_SCRATCH_POOL_ALIGN *
+      CHEESE_SCRATCH_POOL_ALIGN;
+}
+
+CheeseScratchPool::CheeseScratchPool ()
+{
+  _width = 0;
+  _height = 0;
+  _format = GST_VIDEO_FORMAT_UNKNOWN;
+  n_allocations = 0;
+}
+
+/**
+ * Keys the pool to the frames described by @info. Returns TRUE if they
+ * differ from the previous ones, in which case the buffers are released and
+ * the slots have to be reserved again.
+ **/
+gboolean
+CheeseScratchPool::configure (const GstVideoInfo * info)
+{
+  if (GST_VIDEO_INFO_WIDTH (info) == _width &&
+      GST_VIDEO_INFO_HEIGHT (info) == _height &&
+      GST_VIDEO_INFO_FORMAT (info) == _format)
+    return FALSE;
+
+  clear ();
+  _width = GST_VIDEO_INFO_WIDTH (info);
+  _height = GST_VIDEO_INFO_HEIGHT (info);
+  _format = GST_VIDEO_INFO_FORMAT (info);
+  return TRUE;
+}
+
+void
+CheeseScratchPool::clear ()
+{
+  _buffers.clear ();
+  _width = 0;
+  _height = 0;
+  _format = GST_VIDEO_FORMAT_UNKNOWN;
+}
+
+cv::Size
+CheeseScratchPool::frame_size ()
+{
+  return cv::Size (_width, _height);
+}
+
+/* Gives at least @size aligned bytes for @slot, buffers only ever grow. */
+guint8 *
+CheeseScratchPool::storage (guint slot, gsize size)
+{
+  /* OpenCV only aligns its allocations to 16 bytes in some versions. */
+  size += CHEESE_SCRATCH_POOL_ALIGN;
+  if (slot >= _buffers.size ())
+    _buffers.resize (slot + 1);
+
+  if (_buffers[slot].total () < size) {
+    _buffers[slot].create (1, size, CV_8UC1);
+    n_allocations++;
+  }
+
+  return cv::alignPtr (_buffers[slot].data, CHEESE_SCRATCH_POOL_ALIGN);
+}
+
+/* Makes room in @slot for a frame sized image of @type. */
+void
+CheeseScratchPool::reserve (guint slot, gint type)
+{
+  reserve (slot, frame_size (), type);
+}
+
+void
+CheeseScratchPool::reserve (guint slot, cv::Size size, gint type)
+{
+  storage (slot, size.height * cheese_scratch_pool_stride (size.width, type));
+}
+
+cv::Mat
+CheeseScratchPool::get (guint slot, gint type)
+{
+  return get (slot, frame_size (), type);
+}
+
+/**
+ * Gives the image in @slot, it keeps whatever was written on it before.
+ * It only allocates if the slot was not reserved for an image this large.
+ **/
+cv::Mat
+CheeseScratchPool::get (guint slot, cv::Size size, gint type)
+{
+  gsize stride = cheese_scratch_pool_stride (size.width, type);
+
+  return cv::Mat (size, type, storage (slot, size.height * stride), stride);
+}
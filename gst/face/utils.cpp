@@ -61,3 +61,13 @@ cv_rect_to_dlib_rectangle (cv::Rect2d & cv_rect, dlib::rectangle & dlib_rect)
 
   dlib_rect = dlib::rectangle (tl_x, tl_y, br_x, br_y);
 }
+
+/* Runs the shape predictor on an RGB image or on a single luma plane. */
+dlib::full_object_detection
+cheese_shape_predict (dlib::shape_predictor & shape_predictor, cv::Mat & img,
+    const dlib::rectangle & rect)
+{
+  if (img.channels () == 1)
+    return shape_predictor (dlib::cv_image<unsigned char> (img), rect);
+  return shape_predictor (dlib::cv_image<dlib::bgr_pixel> (img), rect);
+}
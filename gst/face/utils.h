@@ -46,6 +46,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <dlib/opencv.h>
+#include <dlib/image_processing/shape_predictor.h>
 #include <glib.h>
 
 G_BEGIN_DECLS
@@ -54,6 +55,9 @@ void dlib_rectangle_to_cv_rect (dlib::rectangle & dlib_rect,
     cv::Rect2d & cv_rect);
 void cv_rect_to_dlib_rectangle (cv::Rect2d & cv_rect,
     dlib::rectangle & dlib_rect);
+dlib::full_object_detection cheese_shape_predict (
+    dlib::shape_predictor & shape_predictor, cv::Mat & img,
+    const dlib::rectangle & rect);
 
 G_END_DECLS
 
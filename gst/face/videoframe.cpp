@@ -0,0 +1,143 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/opencv/gstopencvvideofilter.h>
+
+#include "videoframe.h"
+
+/* Channels of the images cheese_video_frame_get_cv_mat () gives. */
+gint
+cheese_video_frame_channels (const GstVideoInfo * info)
+{
+  return GST_VIDEO_INFO_FORMAT (info) == GST_VIDEO_FORMAT_RGB ? 3 : 1;
+}
+
+/**
+ * Wraps into @img the pixels the face elements work on: the RGB plane, or
+ * the luma plane of the YUV and GRAY8 formats, without copying them. The
+ * luma of YUY2 is interleaved with the chroma so it is gathered into
+ * @scratch, cheese_video_frame_put_cv_mat () writes it back.
+ **/
+void
+cheese_video_frame_get_cv_mat (GstVideoFrame * frame, cv::Mat & img,
+    cv::Mat & scratch)
+{
+  gint width = GST_VIDEO_FRAME_WIDTH (frame);
+  gint height = GST_VIDEO_FRAME_HEIGHT (frame);
+  gpointer data = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+
+  switch (GST_VIDEO_FRAME_FORMAT (frame)) {
+    case GST_VIDEO_FORMAT_RGB:
+      img = cv::Mat (height, width, CV_8UC3, data, stride);
+      break;
+    case GST_VIDEO_FORMAT_YUY2:
+      cv::extractChannel (cv::Mat (height, width, CV_8UC2, data, stride),
+          scratch, 0);
+      img = scratch;
+      break;
+    default:
+      /* I420, NV12 and GRAY8 start with a full luma plane. */
+      img = cv::Mat (height, width, CV_8UC1, data, stride);
+      break;
+  }
+}
+
+/* Writes back what was drawn on @img, if it is not the frame itself. */
+void
+cheese_video_frame_put_cv_mat (GstVideoFrame * frame, cv::Mat & img)
+{
+  if (GST_VIDEO_FRAME_FORMAT (frame) == GST_VIDEO_FORMAT_YUY2) {
+    cv::Mat packed (GST_VIDEO_FRAME_HEIGHT (frame),
+        GST_VIDEO_FRAME_WIDTH (frame), CV_8UC2,
+        GST_VIDEO_FRAME_PLANE_DATA (frame, 0),
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0));
+    cv::insertChannel (img, packed, 0);
+  }
+}
+
+/* Gives the color to draw with on @img, its luma if it has a single plane. */
+cv::Scalar
+cheese_video_frame_color (const cv::Scalar & rgb, cv::Mat & img)
+{
+  if (img.channels () == 1)
+    return cv::Scalar (0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2]);
+  return rgb;
+}
+
+/**
+ * The OpenCV base class only negotiates RGB-like formats, the frames are
+ * wrapped by cheese_video_frame_transform_frame_ip () instead. Keys @pool
+ * to the new frames.
+ **/
+gboolean
+cheese_video_frame_set_info (GstVideoFilter * vfilter, GstVideoInfo * info,
+    CheeseScratchPool * pool)
+{
+  GST_DEBUG_OBJECT (vfilter, "Working on %s frames.",
+      GST_VIDEO_INFO_NAME (info));
+
+  pool->configure (info);
+  if (GST_VIDEO_INFO_FORMAT (info) == GST_VIDEO_FORMAT_YUY2)
+    pool->reserve (CHEESE_SCRATCH_POOL_LUMA, CV_8UC1);
+  return TRUE;
+}
+
+GstFlowReturn
+cheese_video_frame_transform_frame_ip (GstVideoFilter * vfilter,
+    GstVideoFrame * frame, CheeseScratchPool * pool)
+{
+  GstOpencvVideoFilterClass *klass =
+      GST_OPENCV_VIDEO_FILTER_GET_CLASS (vfilter);
+  GstFlowReturn ret;
+  cv::Mat img, scratch;
+
+  if (GST_VIDEO_FRAME_FORMAT (frame) == GST_VIDEO_FORMAT_YUY2)
+    scratch = pool->get (CHEESE_SCRATCH_POOL_LUMA, CV_8UC1);
+  cheese_video_frame_get_cv_mat (frame, img, scratch);
+  ret = klass->cv_trans_ip_func (GST_OPENCV_VIDEO_FILTER (vfilter),
+      frame->buffer, img);
+  cheese_video_frame_put_cv_mat (frame, img);
+
+  return ret;
+}
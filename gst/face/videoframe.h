@@ -0,0 +1,72 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GSTCHEESEFACE_VIDEO_FRAME_H__
+#define __GSTCHEESEFACE_VIDEO_FRAME_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideofilter.h>
+#include <opencv2/opencv.hpp>
+
+#include "scratchpool.h"
+
+G_BEGIN_DECLS
+
+/* Formats the face elements work on, without converting them. */
+#define CHEESE_VIDEO_FRAME_FORMATS "{ RGB, I420, NV12, YUY2, GRAY8 }"
+
+gint cheese_video_frame_channels (const GstVideoInfo * info);
+void cheese_video_frame_get_cv_mat (GstVideoFrame * frame, cv::Mat & img,
+    cv::Mat & scratch);
+void cheese_video_frame_put_cv_mat (GstVideoFrame * frame, cv::Mat & img);
+cv::Scalar cheese_video_frame_color (const cv::Scalar & rgb, cv::Mat & img);
+
+gboolean cheese_video_frame_set_info (GstVideoFilter * vfilter,
+    GstVideoInfo * info, CheeseScratchPool * pool);
+GstFlowReturn cheese_video_frame_transform_frame_ip (GstVideoFilter * vfilter,
+    GstVideoFrame * frame, CheeseScratchPool * pool);
+
+G_END_DECLS
+
+#endif /* __GSTCHEESEFACE_VIDEO_FRAME_H__ */
@@ -0,0 +1,180 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "workerpool.h"
+
+/**
+ * A process-wide pool of threads shared by all the face elements. A batch of
+ * tasks is run by the calling thread together with some helper threads of
+ * the pool: each of them takes the next pending index until none is left, so
+ * faster threads end up doing more tasks. As the calling thread always takes
+ * part, a batch finishes even if all the threads of the pool are busy.
+ **/
+
+typedef struct _CheeseWorkerBatch CheeseWorkerBatch;
+struct _CheeseWorkerBatch {
+  CheeseWorkerFunc func;
+  gpointer user_data;
+  guint n_tasks;
+  gint next_task;
+  guint n_done;
+  gint ref_count;
+  GMutex lock;
+  GCond cond;
+};
+
+static void
+cheese_worker_batch_unref (CheeseWorkerBatch * batch)
+{
+  if (!g_atomic_int_dec_and_test (&batch->ref_count))
+    return;
+  g_mutex_clear (&batch->lock);
+  g_cond_clear (&batch->cond);
+  g_slice_free (CheeseWorkerBatch, batch);
+}
+
+static void
+cheese_worker_batch_work (CheeseWorkerBatch * batch)
+{
+  guint index, n_done = 0;
+
+  while ((index = (guint) g_atomic_int_add (&batch->next_task, 1)) <
+      batch->n_tasks) {
+    batch->func (index, batch->user_data);
+    n_done++;
+  }
+
+  if (n_done == 0)
+    return;
+  g_mutex_lock (&batch->lock);
+  batch->n_done += n_done;
+  if (batch->n_done == batch->n_tasks)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+static void
+cheese_worker_pool_helper (gpointer data, gpointer user_data)
+{
+  CheeseWorkerBatch *batch = (CheeseWorkerBatch *) data;
+
+  cheese_worker_batch_work (batch);
+  cheese_worker_batch_unref (batch);
+}
+
+static GThreadPool *
+cheese_worker_pool_get ()
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool)) {
+    GThreadPool *new_pool = g_thread_pool_new (cheese_worker_pool_helper,
+        NULL, g_get_num_processors (), FALSE, NULL);
+    g_once_init_leave (&pool, new_pool);
+  }
+  return pool;
+}
+
+/**
+ * cheese_worker_pool_get_n_threads:
+ *
+ * Returns: the maximum number of threads a batch can run on.
+ */
+guint
+cheese_worker_pool_get_n_threads ()
+{
+  return g_get_num_processors ();
+}
+
+/**
+ * cheese_worker_pool_run:
+ * @n_tasks: the number of tasks.
+ * @max_threads: the maximum number of threads to use, including the calling
+ * one, or 0 to use as many as processors.
+ * @func: the function called for each task with its index.
+ * @user_data: the data passed to @func.
+ *
+ * Calls @func for every index from 0 to @n_tasks - 1 in parallel and waits
+ * for all of them. There is no guarantee about the order the tasks are run
+ * in, so @func must only write the results of its own index.
+ */
+void
+cheese_worker_pool_run (guint n_tasks, guint max_threads,
+    CheeseWorkerFunc func, gpointer user_data)
+{
+  CheeseWorkerBatch *batch;
+  guint i, n_helpers;
+
+  if (max_threads == 0 || max_threads > cheese_worker_pool_get_n_threads ())
+    max_threads = cheese_worker_pool_get_n_threads ();
+  n_helpers = MIN (n_tasks, max_threads);
+  n_helpers = n_helpers > 0 ? n_helpers - 1 : 0;
+
+  /* Not worth waking up any thread. */
+  if (n_helpers == 0) {
+    for (i = 0; i < n_tasks; i++)
+      func (i, user_data);
+    return;
+  }
+
+  batch = g_slice_new0 (CheeseWorkerBatch);
+  batch->func = func;
+  batch->user_data = user_data;
+  batch->n_tasks = n_tasks;
+  batch->next_task = 0;
+  batch->n_done = 0;
+  batch->ref_count = 1 + n_helpers;
+  g_mutex_init (&batch->lock);
+  g_cond_init (&batch->cond);
+
+  for (i = 0; i < n_helpers; i++)
+    g_thread_pool_push (cheese_worker_pool_get (), batch, NULL);
+
+  cheese_worker_batch_work (batch);
+
+  g_mutex_lock (&batch->lock);
+  while (batch->n_done < batch->n_tasks)
+    g_cond_wait (&batch->cond, &batch->lock);
+  g_mutex_unlock (&batch->lock);
+
+  cheese_worker_batch_unref (batch);
+}
@@ -0,0 +1,257 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Checks the assignment of the face elements against an exhaustive search
+ * on small random matrices, and the gated one against a dense matrix with
+ * the far pairs forbidden. */
+
+#include <glib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "assignment.h"
+#include "gating.h"
+
+#define MAX_SIZE              6
+#define N_MATRICES            2000
+#define MAX_POINTS            40
+
+/* Lowest total cost over every permutation, with the rows beyond the number
+ * of columns left out. */
+static gdouble
+brute_force_cost (CheeseAssignment & solver)
+{
+  guint r, n = MAX (solver.rows (), solver.cols ());
+  std::vector<guint> perm (n);
+  gdouble best = G_MAXDOUBLE;
+
+  for (r = 0; r < n; r++)
+    perm[r] = r;
+  do {
+    gdouble cost = 0.0;
+
+    for (r = 0; r < solver.rows (); r++) {
+      if (perm[r] < solver.cols ())
+        cost += solver.at (r, perm[r]);
+    }
+    best = MIN (best, cost);
+  } while (std::next_permutation (perm.begin (), perm.end ()));
+  return best;
+}
+
+static void
+check_optimal (CheeseAssignment & solver)
+{
+  std::vector<gint> assignment (solver.rows ());
+  std::vector<gboolean> used (solver.cols (), FALSE);
+  guint r, n_assigned = 0;
+  gdouble cost = 0.0;
+
+  solver.solve (assignment.data ());
+  for (r = 0; r < solver.rows (); r++) {
+    if (assignment[r] == -1)
+      continue;
+    g_assert_cmpint (assignment[r], <, (gint) solver.cols ());
+    g_assert_false (used[assignment[r]]);
+    used[assignment[r]] = TRUE;
+    cost += solver.at (r, assignment[r]);
+    n_assigned++;
+  }
+  g_assert_cmpuint (n_assigned, ==, MIN (solver.rows (), solver.cols ()));
+  g_assert_cmpfloat (ABS (cost - brute_force_cost (solver)), <, 1e-3);
+}
+
+static void
+test_random_matrices ()
+{
+  CheeseAssignment solver;
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i, r, c;
+
+  for (i = 0; i < N_MATRICES; i++) {
+    guint rows = g_rand_int_range (rand, 1, MAX_SIZE + 1);
+    guint cols = g_rand_int_range (rand, 1, MAX_SIZE + 1);
+    /* Few distinct costs make plenty of ties. */
+    gboolean ties = i % 2;
+
+    solver.resize (rows, cols);
+    for (r = 0; r < rows; r++) {
+      for (c = 0; c < cols; c++) {
+        solver.at (r, c) = ties ? g_rand_int_range (rand, 0, 4) :
+            g_rand_double_range (rand, 0.0, 500.0);
+      }
+    }
+    check_optimal (solver);
+  }
+  g_rand_free (rand);
+}
+
+static void
+test_forbidden_pairs ()
+{
+  CheeseAssignment solver;
+  gint assignment[2];
+
+  /* Both rows want the first column, the second one can not have any. */
+  solver.resize (2, 2);
+  solver.at (0, 0) = 1.0;
+  solver.at (0, 1) = CHEESE_ASSIGNMENT_FORBIDDEN;
+  solver.at (1, 0) = 2.0;
+  solver.at (1, 1) = CHEESE_ASSIGNMENT_FORBIDDEN;
+  solver.solve (assignment);
+  g_assert_cmpint (assignment[0], ==, 0);
+  g_assert_cmpint (assignment[1], ==, -1);
+}
+
+static void
+test_empty ()
+{
+  CheeseAssignment solver;
+  gint assignment[3];
+
+  solver.resize (3, 0);
+  solver.solve (assignment);
+  g_assert_cmpint (assignment[0], ==, -1);
+  g_assert_cmpint (assignment[2], ==, -1);
+  solver.resize (0, 3);
+  solver.solve (assignment);
+}
+
+static void
+test_gated_matches_dense ()
+{
+  CheeseGatedAssignment gated;
+  CheeseAssignment dense;
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i, r, c;
+
+  for (i = 0; i < N_MATRICES; i++) {
+    guint n_rows = g_rand_int_range (rand, 1, MAX_POINTS);
+    guint n_cols = g_rand_int_range (rand, 1, MAX_POINTS);
+    gint size = g_rand_int_range (rand, 200, 2000);
+    std::vector<cv::Point> rows (n_rows), cols (n_cols);
+    std::vector<gfloat> radii (n_rows), col_radii (n_cols);
+    /* Every other matrix also limits the pairs by the column. */
+    gboolean limit_cols = i % 2;
+    std::vector<gint> assignment (n_rows), expected (n_rows);
+    gdouble cost = 0.0, expected_cost = 0.0;
+
+    for (r = 0; r < n_rows; r++) {
+      rows[r] = cv::Point (g_rand_int_range (rand, 0, size),
+          g_rand_int_range (rand, 0, size));
+      radii[r] = g_rand_double_range (rand, 0.0, 150.0);
+    }
+    for (c = 0; c < n_cols; c++) {
+      cols[c] = cv::Point (g_rand_int_range (rand, 0, size),
+          g_rand_int_range (rand, 0, size));
+      col_radii[c] = g_rand_double_range (rand, 0.0, 150.0);
+    }
+
+    dense.resize (n_rows, n_cols);
+    for (r = 0; r < n_rows; r++) {
+      for (c = 0; c < n_cols; c++) {
+        gdouble dist = cv::norm (rows[r] - cols[c]);
+        gboolean gated = dist < radii[r] &&
+            (!limit_cols || dist < col_radii[c]);
+        dense.at (r, c) = gated ? dist : CHEESE_ASSIGNMENT_FORBIDDEN;
+      }
+    }
+    dense.solve (expected.data ());
+    gated.solve (rows.data (), radii.data (), n_rows, cols.data (),
+        limit_cols ? col_radii.data () : NULL, n_cols, assignment.data ());
+
+    for (r = 0; r < n_rows; r++) {
+      g_assert_cmpint (assignment[r] == -1, ==, expected[r] == -1);
+      if (assignment[r] != -1) {
+        g_assert_cmpfloat (dense.at (r, assignment[r]), <,
+            CHEESE_ASSIGNMENT_FORBIDDEN);
+        cost += dense.at (r, assignment[r]);
+        expected_cost += dense.at (r, expected[r]);
+      }
+    }
+    g_assert_cmpfloat (ABS (cost - expected_cost), <, 1e-2);
+  }
+  g_rand_free (rand);
+}
+
+static void
+test_far_pairs ()
+{
+  CheeseGatedAssignment gated;
+  /* The first detection jumped far from its face, the second one is next to
+   * its face and the third one has no face left. */
+  const cv::Point dets[] = {
+    cv::Point (400, 100), cv::Point (1010, 1000), cv::Point (2000, 2000)
+  };
+  const gfloat radii[] = { 50.0, 50.0, 50.0 };
+  const cv::Point faces[] = { cv::Point (1000, 1000), cv::Point (100, 100) };
+  gint assignment[G_N_ELEMENTS (dets)];
+  gboolean far[G_N_ELEMENTS (dets)];
+
+  gated.solve_far (dets, radii, G_N_ELEMENTS (dets), faces, NULL,
+      G_N_ELEMENTS (faces), assignment, far);
+  g_assert_cmpint (assignment[0], ==, 1);
+  g_assert_true (far[0]);
+  g_assert_cmpint (assignment[1], ==, 0);
+  g_assert_false (far[1]);
+  g_assert_cmpint (assignment[2], ==, -1);
+  g_assert_false (far[2]);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/face/assignment/test_random_matrices",
+      test_random_matrices);
+  g_test_add_func ("/face/assignment/test_forbidden_pairs",
+      test_forbidden_pairs);
+  g_test_add_func ("/face/assignment/test_empty", test_empty);
+  g_test_add_func ("/face/assignment/test_gated_matches_dense",
+      test_gated_matches_dense);
+  g_test_add_func ("/face/assignment/test_far_pairs", test_far_pairs);
+
+  return g_test_run ();
+}
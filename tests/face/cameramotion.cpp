@@ -0,0 +1,132 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Checks the estimate of the motion of the camera on synthetic frames: a
+ * textured frame moved by a known similarity has to give it back. */
+
+#include <glib.h>
+
+#include "cameramotion.h"
+
+#define FRAME_WIDTH           640
+#define FRAME_HEIGHT          480
+
+static cv::Mat
+textured_frame ()
+{
+  cv::RNG rng (0xca3e7a);
+  cv::Mat frame (FRAME_HEIGHT, FRAME_WIDTH, CV_8UC1);
+
+  rng.fill (frame, cv::RNG::UNIFORM, 0, 256);
+  cv::GaussianBlur (frame, frame, cv::Size (7, 7), 0);
+  return frame;
+}
+
+static void
+check_motion (const cv::Matx23d & expected)
+{
+  CheeseCameraMotion camera_motion;
+  cv::Mat frame = textured_frame ();
+  cv::Mat moved;
+  cv::Matx23d motion;
+  guint i, j;
+
+  cv::warpAffine (frame, moved, cv::Mat (expected), frame.size (),
+      cv::INTER_LINEAR, cv::BORDER_REFLECT_101);
+
+  /* The first frame has nothing to be compared with. */
+  g_assert_false (camera_motion.estimate (frame, motion));
+  g_assert_true (camera_motion.estimate (moved, motion));
+  g_assert_cmpuint (camera_motion.n_inliers, >=,
+      CHEESE_CAMERA_MOTION_MIN_INLIERS);
+  for (i = 0; i < 2; i++) {
+    for (j = 0; j < 2; j++)
+      g_assert_cmpfloat (ABS (motion (i, j) - expected (i, j)), <, 0.01);
+    g_assert_cmpfloat (ABS (motion (i, 2) - expected (i, 2)), <, 1.0);
+  }
+
+  /* Once reset, the next frame is the first one again. */
+  camera_motion.reset ();
+  g_assert_false (camera_motion.estimate (moved, motion));
+}
+
+static void
+test_translation ()
+{
+  check_motion (cv::Matx23d (1.0, 0.0, 12.0, 0.0, 1.0, -7.0));
+}
+
+static void
+test_similarity ()
+{
+  const gdouble angle = 2.0 * CV_PI / 180.0;
+  const gdouble scale = 1.03;
+  cv::Matx23d m (scale * cos (angle), -scale * sin (angle), 0.0,
+      scale * sin (angle), scale * cos (angle), 0.0);
+
+  /* Around the center of the frame, then moved a bit. */
+  m (0, 2) = FRAME_WIDTH / 2 - m (0, 0) * FRAME_WIDTH / 2 -
+      m (0, 1) * FRAME_HEIGHT / 2 + 5.0;
+  m (1, 2) = FRAME_HEIGHT / 2 - m (1, 0) * FRAME_WIDTH / 2 -
+      m (1, 1) * FRAME_HEIGHT / 2 + 3.0;
+  check_motion (m);
+}
+
+static void
+test_still_camera ()
+{
+  check_motion (cv::Matx23d (1.0, 0.0, 0.0, 0.0, 1.0, 0.0));
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/face/cameramotion/test_translation", test_translation);
+  g_test_add_func ("/face/cameramotion/test_similarity", test_similarity);
+  g_test_add_func ("/face/cameramotion/test_still_camera",
+      test_still_camera);
+  return g_test_run ();
+}
@@ -0,0 +1,170 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Checks the constant velocity Kalman filter of the tracked faces: it
+ * learns the velocity of a moving box, keeps moving it while it is not
+ * measured and widens its gate meanwhile. */
+
+#include <glib.h>
+
+#include "kalman.h"
+
+#define WIDTH                 100.0
+#define N_FRAMES              30
+#define N_DROPPED             10
+
+static const cv::Point2d velocity (5.0, -3.0);
+
+/* Box of the face moving at the constant velocity on @frame. */
+static cv::Rect2d
+moving_box (guint frame)
+{
+  return cv::Rect2d (200.0 + velocity.x * frame, 300.0 + velocity.y * frame,
+      WIDTH, WIDTH);
+}
+
+static gdouble
+centroid_error (const cv::Rect2d & a, const cv::Rect2d & b)
+{
+  return cv::norm ((a.tl () + a.br ()) * 0.5 - (b.tl () + b.br ()) * 0.5);
+}
+
+static void
+test_constant_velocity ()
+{
+  CheeseKalmanBox kalman;
+  guint i;
+
+  kalman.init (moving_box (0));
+  for (i = 1; i <= N_FRAMES; i++) {
+    kalman.predict ();
+    kalman.correct (moving_box (i));
+  }
+  g_assert_cmpfloat (cv::norm (kalman.velocity () - velocity), <, 0.5);
+  g_assert_cmpfloat (centroid_error (kalman.box (), moving_box (N_FRAMES)),
+      <, 1.0);
+  g_assert_cmpfloat (ABS (kalman.box ().width - WIDTH), <, 1e-6);
+
+  /* The next frame is predicted where the face goes. */
+  kalman.predict ();
+  g_assert_cmpfloat (
+      centroid_error (kalman.box (), moving_box (N_FRAMES + 1)), <, 1.0);
+}
+
+static void
+test_dropout ()
+{
+  CheeseKalmanBox kalman;
+  gdouble radius, tracked_radius;
+  guint i;
+
+  kalman.init (moving_box (0));
+  for (i = 1; i <= N_FRAMES; i++) {
+    kalman.predict ();
+    kalman.correct (moving_box (i));
+  }
+  tracked_radius = kalman.gate_radius ();
+
+  /* Not measured for a while, the box keeps its velocity and the gate
+   * widens every frame. */
+  radius = tracked_radius;
+  for (i = N_FRAMES + 1; i <= N_FRAMES + N_DROPPED; i++) {
+    kalman.predict ();
+    g_assert_cmpfloat (kalman.gate_radius (), >=, radius);
+    radius = kalman.gate_radius ();
+  }
+  g_assert_cmpfloat (radius, >, tracked_radius);
+  g_assert_cmpfloat (
+      centroid_error (kalman.box (), moving_box (N_FRAMES + N_DROPPED)), <,
+      N_DROPPED * 0.5);
+  /* The face found again is within the gate. */
+  g_assert_cmpfloat (
+      centroid_error (kalman.box (), moving_box (N_FRAMES + N_DROPPED)), <,
+      radius);
+
+  /* A measure shrinks it back. */
+  kalman.correct (moving_box (N_FRAMES + N_DROPPED));
+  g_assert_cmpfloat (kalman.gate_radius (), <, radius);
+}
+
+static void
+test_gate_is_at_least_the_width ()
+{
+  CheeseKalmanBox kalman;
+
+  g_assert_false (kalman.initialized ());
+  kalman.correct (moving_box (0));
+  g_assert_true (kalman.initialized ());
+  g_assert_cmpfloat (kalman.gate_radius (), >=, WIDTH);
+}
+
+static void
+test_transform ()
+{
+  CheeseKalmanBox kalman;
+  cv::Rect2d box;
+
+  kalman.init (moving_box (0));
+  kalman.transform (cv::Matx23d (2.0, 0.0, 10.0, 0.0, 2.0, -5.0));
+  box = kalman.box ();
+  g_assert_cmpfloat (ABS (box.width - 2 * WIDTH), <, 1e-6);
+  g_assert_cmpfloat (ABS (box.x + box.width * 0.5 - (2 * 250.0 + 10.0)), <,
+      1e-6);
+  g_assert_cmpfloat (ABS (box.y + box.height * 0.5 - (2 * 350.0 - 5.0)), <,
+      1e-6);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/face/kalman/test_constant_velocity",
+      test_constant_velocity);
+  g_test_add_func ("/face/kalman/test_dropout", test_dropout);
+  g_test_add_func ("/face/kalman/test_gate_is_at_least_the_width",
+      test_gate_is_at_least_the_width);
+  g_test_add_func ("/face/kalman/test_transform", test_transform);
+  return g_test_run ();
+}
@@ -0,0 +1,103 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Checks that the SIMD conversion to luma of CheeseLumaScaler gives exactly
+ * the same images as the plain C one. Odd sizes make the rows end with
+ * pixels the vector loops do not cover. */
+
+#include <glib.h>
+
+#include "lumascaler.h"
+
+static void
+test_simd_matches_c ()
+{
+  static const gint sizes[][2] = {
+    { 1, 1 }, { 15, 3 }, { 17, 5 }, { 33, 9 }, { 641, 479 }, { 1279, 719 }
+  };
+  static const gdouble scale_factors[] = { 1.0, 0.5, 1.0 / 3, 0.3, 0.25 };
+  CheeseLumaScaler simd, c;
+  cv::RNG rng (42);
+  guint i, j;
+
+  c.simd = FALSE;
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    cv::Mat frame (sizes[i][1], sizes[i][0], CV_8UC3);
+
+    rng.fill (frame, cv::RNG::UNIFORM, 0, 256);
+    for (j = 0; j < G_N_ELEMENTS (scale_factors); j++) {
+      cv::Mat expected = c.scale (frame, scale_factors[j]);
+      cv::Mat luma = simd.scale (frame, scale_factors[j]);
+
+      g_assert_cmpint (luma.cols, ==, expected.cols);
+      g_assert_cmpint (luma.rows, ==, expected.rows);
+      g_assert_cmpfloat (cv::norm (luma, expected, cv::NORM_INF), ==, 0.0);
+    }
+  }
+}
+
+static void
+test_c_is_bt601 ()
+{
+  CheeseLumaScaler c;
+  cv::Mat frame (3, 17, CV_8UC3, cv::Scalar (200, 100, 50));
+  cv::Mat luma;
+
+  c.simd = FALSE;
+  luma = c.scale (frame, 1.0);
+  g_assert_cmpint (luma.at<guint8> (2, 16), ==,
+      (77 * 200 + 150 * 100 + 29 * 50 + 128) >> 8);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/face/lumascaler/test_simd_matches_c",
+      test_simd_matches_c);
+  g_test_add_func ("/face/lumascaler/test_c_is_bt601",
+      test_c_is_bt601);
+  return g_test_run ();
+}
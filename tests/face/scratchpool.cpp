@@ -0,0 +1,206 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Checks that the per frame images of the face elements are allocated once
+ * for the negotiated caps and not while streaming. The OpenCV allocator is
+ * wrapped so every image allocated in between frames is counted. */
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "lumascaler.h"
+#include "scratchpool.h"
+
+#define FRAME_WIDTH           1280
+#define FRAME_HEIGHT          720
+#define N_FRAMES              30
+
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag CheeseAccessFlag;
+#else
+typedef int CheeseAccessFlag;
+#endif
+
+class CountingAllocator : public cv::MatAllocator
+{
+  public:
+    const cv::MatAllocator *allocator;
+    mutable guint n_allocations;
+
+    CountingAllocator ()
+    {
+      allocator = cv::Mat::getStdAllocator ();
+      n_allocations = 0;
+    }
+
+    cv::UMatData * allocate (int dims, const int *sizes, int type,
+        void *data, size_t *step, CheeseAccessFlag flags,
+        cv::UMatUsageFlags usage) const
+    {
+      if (!data)
+        n_allocations++;
+      return allocator->allocate (dims, sizes, type, data, step, flags, usage);
+    }
+
+    bool allocate (cv::UMatData *data, CheeseAccessFlag flags,
+        cv::UMatUsageFlags usage) const
+    {
+      return allocator->allocate (data, flags, usage);
+    }
+
+    void deallocate (cv::UMatData *data) const
+    {
+      allocator->deallocate (data);
+    }
+};
+
+static CountingAllocator counter;
+
+static void
+set_caps (CheeseScratchPool & pool, GstVideoFormat format, gint width,
+    gint height)
+{
+  GstVideoInfo info;
+
+  gst_video_info_init (&info);
+  gst_video_info_set_format (&info, format, width, height);
+  pool.configure (&info);
+}
+
+static void
+test_frames_do_not_allocate ()
+{
+  CheeseScratchPool pool;
+  cv::Mat frame (FRAME_HEIGHT, FRAME_WIDTH, CV_8UC3, cv::Scalar::all (80));
+  guint i, allocations;
+
+  set_caps (pool, GST_VIDEO_FORMAT_RGB, FRAME_WIDTH, FRAME_HEIGHT);
+  pool.reserve (CHEESE_SCRATCH_POOL_USER, CV_8UC3);
+  pool.reserve (CHEESE_SCRATCH_POOL_USER + 1, CV_32FC3);
+  g_assert_cmpuint (pool.n_allocations, ==, 2);
+
+  allocations = counter.n_allocations;
+  for (i = 0; i < N_FRAMES; i++) {
+    cv::Mat mask = pool.get (CHEESE_SCRATCH_POOL_USER, CV_8UC3);
+    cv::Mat result = pool.get (CHEESE_SCRATCH_POOL_USER + 1, CV_32FC3);
+
+    mask.setTo (cv::Scalar::all (255));
+    frame.convertTo (result, CV_32F);
+    cv::multiply (mask, frame, mask, 1.0 / 255);
+    result.convertTo (frame, CV_8U);
+  }
+  g_assert_cmpuint (counter.n_allocations - allocations, ==, 0);
+  g_assert_cmpuint (pool.n_allocations, ==, 2);
+}
+
+static void
+test_strides_are_aligned ()
+{
+  CheeseScratchPool pool;
+  cv::Mat img;
+
+  set_caps (pool, GST_VIDEO_FORMAT_RGB, 641, 479);
+  img = pool.get (CHEESE_SCRATCH_POOL_USER, CV_8UC3);
+  g_assert_cmpint (img.cols, ==, 641);
+  g_assert_cmpint (img.rows, ==, 479);
+  g_assert_cmpuint (img.step[0] % CHEESE_SCRATCH_POOL_ALIGN, ==, 0);
+  g_assert_cmpuint ((gsize) img.data % CHEESE_SCRATCH_POOL_ALIGN, ==, 0);
+}
+
+static void
+test_caps_change_reallocates ()
+{
+  CheeseScratchPool pool;
+
+  set_caps (pool, GST_VIDEO_FORMAT_I420, 640, 480);
+  pool.reserve (CHEESE_SCRATCH_POOL_USER, CV_8UC1);
+  /* The same caps keep the buffers. */
+  set_caps (pool, GST_VIDEO_FORMAT_I420, 640, 480);
+  pool.get (CHEESE_SCRATCH_POOL_USER, CV_8UC1);
+  g_assert_cmpuint (pool.n_allocations, ==, 1);
+
+  set_caps (pool, GST_VIDEO_FORMAT_I420, 1280, 720);
+  pool.get (CHEESE_SCRATCH_POOL_USER, CV_8UC1);
+  g_assert_cmpuint (pool.n_allocations, ==, 2);
+}
+
+static void
+test_luma_scaler_does_not_allocate ()
+{
+  static const gdouble scale_factors[] = { 1.0, 0.5, 0.25 };
+  CheeseLumaScaler scaler;
+  cv::Mat frame (FRAME_HEIGHT, FRAME_WIDTH, CV_8UC3, cv::Scalar (10, 20, 30));
+  guint i, j, allocations;
+
+  for (i = 0; i < G_N_ELEMENTS (scale_factors); i++) {
+    /* The first frame allocates the buffers. */
+    scaler.scale (frame, scale_factors[i]);
+    allocations = counter.n_allocations;
+    for (j = 0; j < N_FRAMES; j++) {
+      cv::Mat luma = scaler.scale (frame, scale_factors[i]);
+
+      g_assert_cmpint (luma.cols, ==, (gint) (FRAME_WIDTH * scale_factors[i]));
+      g_assert_cmpint (luma.at<guint8> (0, 0), ==, 18);
+    }
+    g_assert_cmpuint (counter.n_allocations - allocations, ==, 0);
+  }
+}
+
+int
+main (int argc, char *argv[])
+{
+  gst_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+  cv::Mat::setDefaultAllocator (&counter);
+
+  g_test_add_func ("/face/scratchpool/test_frames_do_not_allocate",
+      test_frames_do_not_allocate);
+  g_test_add_func ("/face/scratchpool/test_strides_are_aligned",
+      test_strides_are_aligned);
+  g_test_add_func ("/face/scratchpool/test_caps_change_reallocates",
+      test_caps_change_reallocates);
+  g_test_add_func ("/face/scratchpool/test_luma_scaler_does_not_allocate",
+      test_luma_scaler_does_not_allocate);
+  return g_test_run ();
+}
@@ -0,0 +1,145 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Checks how a detection phase is split in slices of the image pyramid:
+ * every level, down to those of the faces as tall as the frame, is scanned
+ * by exactly one slice, and the slices cost about the same. */
+
+#include <glib.h>
+#include <math.h>
+
+#include "facedetector.h"
+
+/* Levels of the pyramid of a 640x480 frame, down to 40 pixels. */
+#define N_LEVELS              14
+#define HEIGHT                480
+
+static gdouble
+level_area (guint level)
+{
+  return pow (CHEESE_FACE_DETECTOR_LEVEL_AREA, level);
+}
+
+static void
+test_every_level_once ()
+{
+  guint n_levels, n_slices, level;
+
+  for (n_levels = 1; n_levels <= 20; n_levels++) {
+    for (n_slices = 1; n_slices <= 8; n_slices++) {
+      guint previous = 0;
+
+      /* Consecutive levels, in order, from the first slice. */
+      for (level = 0; level < n_levels; level++) {
+        guint slice =
+            cheese_face_detector_level_slice (level, n_levels, n_slices);
+
+        g_assert_cmpuint (slice, <, n_slices);
+        g_assert_cmpuint (slice, >=, previous);
+        g_assert_cmpuint (slice, <=, previous + 1);
+        if (level == 0)
+          g_assert_cmpuint (slice, ==, 0);
+        previous = slice;
+      }
+    }
+  }
+}
+
+static void
+test_tall_face ()
+{
+  guint level = 0, slice, n_slices;
+
+  /* A face taller than any band overlap, almost as tall as the frame, is
+   * found at a coarse level. */
+  while (CHEESE_FACE_DETECTOR_WINDOW_SIZE * pow (6.0 / 5.0, level + 1) <
+      HEIGHT - 40)
+    level++;
+  g_assert_cmpuint (level, <, N_LEVELS);
+  g_assert_cmpfloat (CHEESE_FACE_DETECTOR_WINDOW_SIZE * pow (6.0 / 5.0, level),
+      >, 160.0);
+
+  for (n_slices = 1; n_slices <= 8; n_slices++) {
+    slice = cheese_face_detector_level_slice (level, N_LEVELS, n_slices);
+    g_assert_cmpuint (slice, <, n_slices);
+  }
+}
+
+static void
+test_slices_cost_about_the_same ()
+{
+  gdouble costs[8], total = 0.0;
+  guint n_slices, level, i;
+
+  for (level = 0; level < N_LEVELS; level++)
+    total += level_area (level);
+
+  for (n_slices = 2; n_slices <= 4; n_slices++) {
+    for (i = 0; i < n_slices; i++)
+      costs[i] = 0.0;
+    for (level = 0; level < N_LEVELS; level++)
+      costs[cheese_face_detector_level_slice (level, N_LEVELS, n_slices)] +=
+          level_area (level);
+    /* No slice is empty, and none is much more than its share or than the
+     * base level, which cannot be split. */
+    for (i = 0; i < n_slices; i++) {
+      g_assert_cmpfloat (costs[i], >, 0.0);
+      g_assert_cmpfloat (costs[i] / total, <,
+          MAX (1.0 / n_slices, level_area (0) / total) + 0.1);
+    }
+  }
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/face/slices/test_every_level_once",
+      test_every_level_once);
+  g_test_add_func ("/face/slices/test_tall_face", test_tall_face);
+  g_test_add_func ("/face/slices/test_slices_cost_about_the_same",
+      test_slices_cost_about_the_same);
+  return g_test_run ();
+}
@@ -0,0 +1,174 @@
+/*
+ * GStreamer Plugins Cheese
+ * Copyright (C) 2018 Fabian Orccon <cfoch.fabian@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Measures how the time to update the trackers of all the faces in a frame
+ * scales with the number of faces, using one thread and then one thread per
+ * processor, for the OpenCV median flow tracker, for the one sharing the
+ * pyramids of the frame, whose time includes building them, and for the
+ * batched MOSSE filters. The frames are synthetic: textured squares moving
+ * over noise. */
+
+#include <glib.h>
+#include <stdio.h>
+#include <gst/cheese/face/cheesefaceinfo.h>
+#include <gst/cheese/face/cheesemultifacemeta.h>
+
+#include <map>
+#include <vector>
+
+#include "facetrack.h"
+#include "flowpyramid.h"
+#include "workerpool.h"
+
+#define FRAME_WIDTH           1280
+#define FRAME_HEIGHT          720
+#define FACE_SIZE             80
+#define FACES_PER_ROW         8
+#define MAX_FACES             16
+#define N_FRAMES              30
+#define STEP                  2
+
+static void
+draw_frame (cv::Mat & frame, cv::Mat & background,
+    std::vector<cv::Mat> & patches, guint n_faces, guint t)
+{
+  guint i;
+
+  background.copyTo (frame);
+  for (i = 0; i < n_faces; i++) {
+    cv::Rect roi (40 + (i % FACES_PER_ROW) * (FACE_SIZE + 60) + t * STEP,
+        60 + (i / FACES_PER_ROW) * (FACE_SIZE + 120) + t * STEP,
+        FACE_SIZE, FACE_SIZE);
+    patches[i].copyTo (frame (roi));
+  }
+}
+
+static gdouble
+run (GstCheeseFaceTrackTrackerType tracker_type, guint n_faces,
+    guint max_threads, cv::Mat & background, std::vector<cv::Mat> & patches)
+{
+  /* Outlives the faces, which give their slots back. */
+  CheeseTrackerPool pool;
+  std::map<guint, CheeseFace> faces;
+  std::vector<CheeseFace *> faces_to_track;
+  std::vector<gboolean> found (n_faces);
+  CheeseFlowPyramid pyramid;
+  cv::Mat frame, luma;
+  gint64 start, total = 0;
+  guint i, t;
+
+  draw_frame (frame, background, patches, n_faces, 0);
+  cv::cvtColor (frame, luma, cv::COLOR_RGB2GRAY);
+  pyramid.update (luma);
+  for (i = 0; i < n_faces; i++) {
+    CheeseFace &face = faces[i];
+    dlib::rectangle rect (
+        40 + (i % FACES_PER_ROW) * (FACE_SIZE + 60),
+        60 + (i / FACES_PER_ROW) * (FACE_SIZE + 120),
+        40 + (i % FACES_PER_ROW) * (FACE_SIZE + 60) + FACE_SIZE - 1,
+        60 + (i / FACES_PER_ROW) * (FACE_SIZE + 120) + FACE_SIZE - 1);
+    face.set_bounding_box (rect);
+    face.create_tracker (tracker_type, &pool);
+    face.init_tracker (frame);
+    faces_to_track.push_back (&face);
+  }
+
+  for (t = 1; t <= N_FRAMES; t++) {
+    draw_frame (frame, background, patches, n_faces, t);
+    cv::cvtColor (frame, luma, cv::COLOR_RGB2GRAY);
+    start = g_get_monotonic_time ();
+    if (tracker_type == GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW)
+      pyramid.update (luma);
+    cheese_faces_update_trackers (faces_to_track.data (),
+        faces_to_track.size (), frame, &pyramid, max_threads, found.data ());
+    total += g_get_monotonic_time () - start;
+  }
+
+  return (gdouble) total / N_FRAMES / 1000.0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  cv::RNG rng (0xc4ee5e);
+  cv::Mat background (FRAME_HEIGHT, FRAME_WIDTH, CV_8UC3);
+  std::vector<cv::Mat> patches;
+  guint n_faces;
+
+  rng.fill (background, cv::RNG::UNIFORM, 0, 64);
+  for (n_faces = 0; n_faces < MAX_FACES; n_faces++) {
+    cv::Mat patch (FACE_SIZE, FACE_SIZE, CV_8UC3);
+    rng.fill (patch, cv::RNG::UNIFORM, 64, 256);
+    cv::GaussianBlur (patch, patch, cv::Size (5, 5), 0);
+    patches.push_back (patch);
+  }
+
+  g_print ("Tracker update time per frame (%d processors):\n",
+      cheese_worker_pool_get_n_threads ());
+  g_print ("faces\t1 thread\tall threads\tspeedup\t"
+      "shared 1 thread\tshared all threads\t"
+      "mosse 1 thread\tmosse all threads\n");
+  for (n_faces = 1; n_faces <= MAX_FACES; n_faces++) {
+    gdouble serial, parallel, shared_serial, shared_parallel;
+    gdouble mosse_serial, mosse_parallel;
+
+    serial = run (GST_CHEESEFACETRACK_TRACKER_MEDIANFLOW, n_faces, 1,
+        background, patches);
+    parallel = run (GST_CHEESEFACETRACK_TRACKER_MEDIANFLOW, n_faces, 0,
+        background, patches);
+    shared_serial = run (GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW,
+        n_faces, 1, background, patches);
+    shared_parallel = run (GST_CHEESEFACETRACK_TRACKER_SHARED_MEDIANFLOW,
+        n_faces, 0, background, patches);
+    mosse_serial = run (GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE,
+        n_faces, 1, background, patches);
+    mosse_parallel = run (GST_CHEESEFACETRACK_TRACKER_BATCHED_MOSSE,
+        n_faces, 0, background, patches);
+    g_print ("%u\t%.2f ms\t%.2f ms\t%.2fx\t%.2f ms\t\t%.2f ms\t\t"
+        "%.2f ms\t\t%.2f ms\n", n_faces, serial, parallel,
+        serial / parallel, shared_serial, shared_parallel, mosse_serial,
+        mosse_parallel);
+  }
+
+  return 0;
+}